@@ -1,55 +1,45 @@
 #include "bloompass.h"
 
 const std::string BloomPass::name = "Bloom";
-const std::vector<std::string> BloomPass::bloom_output_textures = { "bloom" };
-BloomPass::BloomPass(unsigned int width, unsigned int height, const std::shared_ptr<DeferredLightingPass> lighting) : PostprocessPass(width, height, lighting, BloomPass::name, BloomPass::bloom_output_textures)
+const std::vector<PostprocessPass::OutputTexture> BloomPass::bloom_output_textures = { { "bloom", "brightColor" } };
+BloomPass::BloomPass(unsigned int width, unsigned int height) : PostprocessPass(width, height, BloomPass::name, BloomPass::bloom_output_textures), params(PARAMS_BINDING)
 {
-	glGenFramebuffers(2, &bloomPingPongFBO[0]);
-	glGenTextures(2, &bloomPingPongBuffers[0]);
-	output_textures[0].id = bloomPingPongBuffers[1];
-
-	for (unsigned int i = 0; i < 2; i++) {
-		glBindFramebuffer(GL_FRAMEBUFFER, bloomPingPongFBO[i]);
-		glBindTexture(GL_TEXTURE_2D, bloomPingPongBuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bloomPingPongBuffers[i], 0);
-	}
+	const float weights[5] = { 0.227027f, 0.1945946f, 0.1216216f, 0.054054f, 0.016216f };
+	for (unsigned int i = 0; i < 5; i++)
+		params.edit().weights[i].x = weights[i];
 
 	bloomBlurShader = std::make_unique<Shader>("src/shaders/bloom.vert", "src/shaders/bloom.frag");
 	bloomBlurShader->use();
 	bloomBlurShader->setInt("image", 0);
+	bloomBlurShader->bindUniformBlock("BloomParams", PARAMS_BINDING);
+	horizontalUniform = bloomBlurShader->uniform<bool>("horizontal");
 }
 
 BloomPass::~BloomPass()
 {
-	glDeleteTextures(2, &bloomPingPongBuffers[0]);
-	glDeleteFramebuffers(2, &bloomPingPongFBO[0]);
+}
+
+void BloomPass::Setup(RenderGraph::Builder& builder)
+{
+	bloomPingPongBuffers[0] = builder.modify("brightColor");
+	bloomPingPongBuffers[1] = builder.create("bloomBlur", { GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_LINEAR });
 }
 
 void BloomPass::Render()
 {
-	bool horizontal = true, first_iteration = true;
+	bool horizontal = true;
+	params.update();
 	bloomBlurShader->use();
-	glActiveTexture(GL_TEXTURE0);
 	for (unsigned int i = 0; i < bloomBlurPasses; i++) {
-		glBindFramebuffer(GL_FRAMEBUFFER, bloomPingPongFBO[horizontal]);
-		bloomBlurShader->setInt("horizontal", horizontal);
-		glBindTexture(GL_TEXTURE_2D, first_iteration ? lighting->colorBuffers[1] : bloomPingPongBuffers[!horizontal]);
+		graph->bindFramebuffer({ bloomPingPongBuffers[horizontal] });
+		bloomBlurShader->set(horizontalUniform, horizontal);
+		GLState::bindTexture(0, GL_TEXTURE_2D, graph->texture(bloomPingPongBuffers[!horizontal]));
 		RenderQuad();
 		horizontal = !horizontal;
-		if (first_iteration) first_iteration = false;
 	}
 }
 
 void BloomPass::ResizeBuffers(unsigned int width, unsigned int height)
 {
 	TARGET_WIDTH = width; TARGET_HEIGHT = height;
-	for (unsigned int i = 0; i < 2; i++) {
-		glBindTexture(GL_TEXTURE_2D, bloomPingPongBuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	}
 }
@@ -2,23 +2,35 @@
 #define BLOOMPASS_H
 
 #include "postprocesspass.h"
-#include "deferredlighting.h"
+#include "uniformbuffer.h"
 
+// std140 layout of the BloomParams uniform block, float array elements are 16 bytes apart
+struct BloomBlock {
+	glm::vec4 weights[5]; // x, gaussian weights of the center texel and the 4 on each side
+};
+
+// Blurs "brightColor" in place, ping-ponging with one scratch texture. An even number of passes ends in brightColor,
+// which the HDR pass then reads as "bloom".
 class BloomPass : public PostprocessPass
 {
 private:
 	std::unique_ptr<Shader> bloomBlurShader;
+	Shader::Uniform<bool> horizontalUniform;
+	UniformBuffer<BloomBlock> params;
 
 	static const std::string name;
-	static const std::vector<std::string> bloom_output_textures;
+	static const std::vector<OutputTexture> bloom_output_textures;
 
-	unsigned int bloomPingPongFBO[2];
-	unsigned int bloomPingPongBuffers[2];
-	unsigned int bloomBlurPasses = 10;
+	RenderGraph::Resource bloomPingPongBuffers[2];
+	static const unsigned int bloomBlurPasses = 10;
+	static_assert(bloomBlurPasses % 2 == 0, "the last blur pass has to write brightColor");
 
 public:
-	BloomPass(unsigned int width, unsigned int height, const std::shared_ptr<DeferredLightingPass> lighting);
+	static const unsigned int PARAMS_BINDING = 4;
+
+	BloomPass(unsigned int width, unsigned int height);
 	~BloomPass();
+	void Setup(RenderGraph::Builder& builder) override;
 	void Render() override;
 	void ResizeBuffers(unsigned int width, unsigned int height) override;
 };
@@ -14,6 +14,8 @@ const float PITCH = 0.0f;
 const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
+const float ZNEAR = 0.1f;
+const float ZFAR = 100.0f;
 
 
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
@@ -36,6 +38,7 @@ public:
 	struct Matrices {
 		glm::mat4 projection;
 		glm::mat4 view;
+		glm::mat4 inverseProjection; // view space position from depth
 	};
 
 	struct Plane
@@ -73,6 +76,8 @@ public:
 	float MovementSpeed;
 	float MouseSensitivity;
 	float Zoom;
+	float ZNear = ZNEAR;
+	float ZFar = ZFAR;
 	ProjectionType projType;
 
 	// constructor with vectors
@@ -123,6 +128,11 @@ public:
 		return frustum;
 	}
 
+	Frustum getFrustum()
+	{
+		return createFrustumFromCamera(*this, Aspect, glm::radians(Zoom), ZNear, ZFar);
+	}
+
 	// processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime)
 	{
@@ -203,9 +213,10 @@ private:
 	// returns the projection matrix (orthogonal or perspective) given screen size
 	void CalcProjectionMatrix() {
 		if (projType == Perspective)
-			matrices.projection = glm::perspective(glm::radians(Zoom), Aspect, 0.1f, 100.0f);
+			matrices.projection = glm::perspective(glm::radians(Zoom), Aspect, ZNear, ZFar);
 		else if (projType == Orthogonal)
 			matrices.projection = glm::ortho(0.0f, Aspect, 0.0f, 1.0f);
+		matrices.inverseProjection = glm::inverse(matrices.projection);
 		projectionIsDirty = true;
 	}
 };
@@ -0,0 +1,202 @@
+#include "constantring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+namespace {
+	PFNGLBUFFERSTORAGEPROC bufferStorage = nullptr;
+}
+
+bool ConstantRing::persistent = false;
+size_t ConstantRing::lastFrameBytes = 0, ConstantRing::segmentSize = 0;
+float ConstantRing::lastWaitTime = 0.0f;
+unsigned int ConstantRing::overflows = 0;
+GLuint ConstantRing::buffer = 0;
+size_t ConstantRing::alignment = 256;
+unsigned int ConstantRing::frame = 0;
+size_t ConstantRing::head = 0, ConstantRing::flushed = 0;
+char* ConstantRing::mapped = nullptr;
+std::vector<char> ConstantRing::staging;
+GLsync ConstantRing::fences[ConstantRing::FRAMES] = {};
+ConstantRing::Range ConstantRing::bound[ConstantRing::MAX_BINDINGS];
+
+void ConstantRing::init(GLADloadproc load)
+{
+	GLint value = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+	if (value > 0) alignment = value;
+
+	// the entry point can exist without the driver exposing the extension
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (name && strcmp(name, "GL_ARB_buffer_storage") == 0)
+			bufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+	}
+	persistent = bufferStorage != nullptr;
+	if (!persistent)
+		std::cout << "Persistent mapping not supported, constants are uploaded with unsynchronized maps" << std::endl;
+	create(1 << 20);
+}
+
+void ConstantRing::create(size_t segment)
+{
+	segmentSize = align(segment);
+	size_t size = segmentSize * FRAMES;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		bufferStorage(GL_UNIFORM_BUFFER, size, NULL, flags);
+		mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+	}
+	else {
+		glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_STREAM_DRAW);
+		staging.resize(size);
+		mapped = staging.data();
+	}
+	head = flushed = frameStart();
+}
+
+// Replaces the buffer with a larger one. The frame's data keeps its offsets into the frame, blocks bound from
+// earlier frames are copied into it. The driver frees the old buffer once the GPU is done with it, so there is
+// nothing to wait for and the new buffer has no fences yet.
+void ConstantRing::grow(size_t segment)
+{
+	size_t start = frameStart(), used = head - start;
+	std::vector<char> frameData(mapped + start, mapped + head);
+	std::vector<char> blocks[MAX_BINDINGS];
+	saveBound(0, start, blocks);
+	saveBound(head, segmentSize * FRAMES, blocks);
+	Range inFrame[MAX_BINDINGS];
+	for (unsigned int b = 0; b < MAX_BINDINGS; b++) {
+		if (bound[b].size && bound[b].offset >= start && bound[b].offset < head)
+			inFrame[b] = { bound[b].offset - start, bound[b].size };
+	}
+
+	for (GLsync& fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (persistent) {
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+	glDeleteBuffers(1, &buffer);
+	create(segment);
+
+	memcpy(mapped + head, frameData.data(), used);
+	head += used;
+	for (unsigned int b = 0; b < MAX_BINDINGS; b++) {
+		bound[b] = {};
+		if (inFrame[b].size) bind(b, inFrame[b].offset, inFrame[b].size);
+	}
+	restoreBound(blocks);
+}
+
+// copies of the blocks whose binding points into [begin, end)
+void ConstantRing::saveBound(size_t begin, size_t end, std::vector<char>* blocks)
+{
+	for (unsigned int b = 0; b < MAX_BINDINGS; b++) {
+		if (bound[b].size && bound[b].offset >= begin && bound[b].offset < end)
+			blocks[b].assign(mapped + bound[b].offset, mapped + bound[b].offset + bound[b].size);
+	}
+}
+
+// writes saved blocks into the current frame and binds them there
+void ConstantRing::restoreBound(std::vector<char>* blocks)
+{
+	for (unsigned int b = 0; b < MAX_BINDINGS; b++) {
+		if (blocks[b].empty()) continue;
+		GLintptr offset;
+		memcpy(allocate(blocks[b].size(), offset), blocks[b].data(), blocks[b].size());
+		bind(b, offset, blocks[b].size());
+	}
+}
+
+void ConstantRing::beginFrame(size_t bytes)
+{
+	// the commands of the frame that just ended are the last to read its segment
+	unsigned int previous = frame % FRAMES;
+	lastFrameBytes = head - previous * segmentSize;
+	if (persistent) {
+		if (fences[previous]) glDeleteSync(fences[previous]);
+		fences[previous] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	frame++;
+	unsigned int segment = frame % FRAMES;
+	head = flushed = frameStart();
+	lastWaitTime = 0.0f;
+
+	// with room to spare, frames that need a little more than the estimate must not overflow
+	if (bytes > segmentSize) {
+		grow(bytes * 2);
+		return;
+	}
+
+	// blocks still bound from the frame that used this segment last (or from any frame, when the buffer is orphaned)
+	// would be overwritten, they move into this frame
+	std::vector<char> blocks[MAX_BINDINGS];
+	bool orphan = !persistent && segment == 0;
+	if (orphan) saveBound(0, segmentSize * FRAMES, blocks);
+	else saveBound(head, head + segmentSize, blocks);
+
+	if (persistent && fences[segment]) {
+		auto start = std::chrono::high_resolution_clock::now();
+		while (glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fences[segment]);
+		fences[segment] = nullptr;
+		lastWaitTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	else if (!persistent && segment == 0) {
+		// orphan: the driver hands out new storage and frees the old one once the GPU is done with it
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, segmentSize * FRAMES, NULL, GL_STREAM_DRAW);
+	}
+	restoreBound(blocks);
+}
+
+void* ConstantRing::allocate(size_t size, GLintptr& offset)
+{
+	size_t start = frameStart();
+	if (head + size > start + segmentSize) {
+		// more than beginFrame() was told about, the frame moves to a buffer with twice the room
+		overflows++;
+		grow(2 * std::max(segmentSize, head - start + align(size)));
+		start = frameStart();
+		std::cout << "Constant ring segment overflowed, grown to " << segmentSize / 1024 << " KB" << std::endl;
+	}
+	char* data = mapped + head;
+	offset = (GLintptr)(head - start);
+	head += align(size);
+	return data;
+}
+
+// copies what was written since the last flush into the buffer, the persistent mapping is coherent and needs nothing
+void ConstantRing::flush()
+{
+	if (persistent || flushed == head) return;
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	void* target = glMapBufferRange(GL_UNIFORM_BUFFER, flushed, head - flushed, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (target) {
+		memcpy(target, mapped + flushed, head - flushed);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+	flushed = head;
+}
+
+void ConstantRing::bind(GLuint binding, GLintptr offset, GLsizeiptr size)
+{
+	flush();
+	size_t start = frameStart() + offset;
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, start, size);
+	if (binding < MAX_BINDINGS) bound[binding] = { start, (size_t)size };
+}
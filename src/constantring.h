@@ -0,0 +1,72 @@
+#ifndef CONSTANT_RING_H
+#define CONSTANT_RING_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <vector>
+
+// One uniform buffer for all constants that change every frame or every draw: the camera matrices, the Lights and
+// Shadows blocks and the per-object matrices of the render list. It is split into FRAMES segments, each frame writes
+// its constants contiguously into the next segment and binds them with glBindBufferRange, so nothing is ever
+// overwritten while the GPU may still read it and no upload waits for the driver.
+// With ARB_buffer_storage (core in 4.4, loaded here because glad stops at 3.3) the buffer is persistently and
+// coherently mapped and beginFrame() waits on the fence of the segment it reuses, which only stalls when the GPU is
+// FRAMES - 1 frames behind. Without it the data is staged in memory and copied with an unsynchronized map when it is
+// bound; the buffer is orphaned whenever the ring wraps, so those maps never touch storage the GPU still reads.
+// Space inside a segment is never reused. A frame that needs more than its segment moves to a larger buffer: what it
+// wrote so far moves along and every binding made through bind() is pointed at the new storage, so offsets handed out
+// earlier stay valid. Blocks still bound from earlier frames are copied forward whenever their storage is reused.
+class ConstantRing {
+public:
+	static const unsigned int FRAMES = 3;
+	static const unsigned int MAX_BINDINGS = 8; // uniform block bindings bind() keeps track of
+
+	// stats
+	static bool persistent;
+	static size_t lastFrameBytes, segmentSize;
+	static float lastWaitTime; // ms beginFrame() waited on the GPU
+	static unsigned int overflows; // frames that outgrew their segment
+
+	// after the context is current
+	static void init(GLADloadproc load);
+	// starts the next segment, with room for at least bytes
+	static void beginFrame(size_t bytes);
+
+	// room for size bytes at an offset into the frame aligned for glBindBufferRange. The offset is valid until the
+	// next beginFrame(), the pointer only until the next allocate().
+	static void* allocate(size_t size, GLintptr& offset);
+	template<typename T>
+	static GLintptr write(const T& data)
+	{
+		GLintptr offset;
+		memcpy(allocate(sizeof(T), offset), &data, sizeof(T));
+		return offset;
+	}
+	static size_t align(size_t size) { return (size + alignment - 1) / alignment * alignment; }
+
+	// offset as returned by allocate() or write() this frame
+	static void bind(GLuint binding, GLintptr offset, GLsizeiptr size);
+
+private:
+	struct Range {
+		size_t offset = 0, size = 0; // absolute, size 0 when the binding doesn't point into the ring
+	};
+	static GLuint buffer;
+	static size_t alignment;
+	static unsigned int frame;
+	static size_t head, flushed; // write position and end of the data already in the buffer, absolute offsets
+	static char* mapped;         // persistent mapping, or the staging copy of the whole buffer
+	static std::vector<char> staging;
+	static GLsync fences[FRAMES];
+	static Range bound[MAX_BINDINGS];
+
+	static size_t frameStart() { return (frame % FRAMES) * segmentSize; }
+	static void create(size_t segment);
+	static void grow(size_t segment);
+	static void saveBound(size_t begin, size_t end, std::vector<char>* blocks);
+	static void restoreBound(std::vector<char>* blocks);
+	static void flush();
+};
+
+#endif
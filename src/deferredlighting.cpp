@@ -1,107 +1,270 @@
 #include "deferredlighting.h"
 
-DeferredLightingPass::DeferredLightingPass(unsigned int width, unsigned int height, std::shared_ptr<GBufferPass> gBuffer) : RenderPass(width, height)
+#include <cctype>
+
+DeferredLightingPass::DeferredLightingPass(unsigned int width, unsigned int height, std::shared_ptr<LightClusters> lightClusters, std::shared_ptr<ShadowMapPass> shadowMap, std::shared_ptr<PointShadowPass> pointShadows, std::shared_ptr<Scene> scene) : RenderPass(width, height)
 {
-	this->gBuffer = gBuffer;
-
-	// output buffer
-	glGenFramebuffers(1, &hdrFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-
-	glGenTextures(2, &colorBuffers[0]);
-	for (unsigned int i = 0; i < 2; i++) {
-		glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-	}
-	unsigned int attachmentsColor[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-	glDrawBuffers(2, attachmentsColor);
-	// create and attach depth buffer (renderbuffer)
-	glGenRenderbuffers(1, &rboDepthLighting);
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepthLighting);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, TARGET_WIDTH, TARGET_HEIGHT);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepthLighting);
-	// finally check if framebuffer is complete
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer not complete!" << std::endl;
-
-	// set shader parameters
-	lightingPassShader = std::make_unique<Shader>("src/shaders/glighting.vert", "src/shaders/glighting.frag");
-
-	lightingPassShader->use();
-	lightingPassShader->setInt("gPosition", 0);
-	lightingPassShader->setInt("gNormal", 1);
-	lightingPassShader->setInt("gAlbedoSpec", 2);
-
-	// bind matrix uniform block
-	lightingPassShader->bindUniformBlock("Matrices", 0);
-	lightingPassShader->bindUniformBlock("Lights", 1);
+	this->lightClusters = lightClusters;
+	this->shadowMap = shadowMap;
+	this->pointShadows = pointShadows;
+	this->scene = scene;
+
+	// set shader parameters, the G-buffer and preprocess units come from the render graph in Setup()
+	lightingPassShaders = std::make_unique<ShaderVariants>("src/shaders/glighting.vert", "src/shaders/glighting.frag",
+		std::vector<std::string>{ "SSAO", "SSR", "CLUSTERED" }, constantDefines(), [this](Shader& shader) {
+			shader.setInt("pointLightData", LightManager::POINT_LIGHT_UNIT);
+			shader.setInt("spotLightData", LightManager::SPOT_LIGHT_UNIT);
+			shader.setInt("clusterData", LightClusters::CLUSTER_UNIT);
+			shader.setInt("lightIndices", LightClusters::LIGHT_INDEX_UNIT);
+			shader.setInt("shadowMap", ShadowMapPass::SHADOW_MAP_UNIT);
+			shader.setInt("shadowMoments", ShadowMapPass::SHADOW_MOMENTS_UNIT);
+			for (unsigned int t = 0; t < POINT_SHADOW_TIERS; t++)
+				shader.setInt("pointShadowMaps[" + std::to_string(t) + "]", PointShadowPass::FIRST_SHADOW_UNIT + t);
+			for (auto& unit : graphUnits)
+				shader.setInt(unit.first, unit.second);
+
+			// bind matrix uniform block
+			shader.bindUniformBlock("Matrices", 0);
+			shader.bindUniformBlock("Lights", 1);
+			shader.bindUniformBlock("Shadows", 2);
+		});
+	// the current combination now, the other 7 in the background so toggling SSAO, SSR or the lighting mode is instant
+	selectVariant();
+	lightingPassShaders->get(lightingVariant);
+	lightingPassShaders->prewarmAll();
+
+	lightVolumeShader = std::make_unique<Shader>("src/shaders/lightvolume.vert", "src/shaders/lightvolume.frag", constantDefines());
+	lightVolumeShader->use();
+	for (unsigned int t = 0; t < POINT_SHADOW_TIERS; t++)
+		lightVolumeShader->setInt("pointShadowMaps[" + std::to_string(t) + "]", PointShadowPass::FIRST_SHADOW_UNIT + t);
+	lightVolumeShader->bindUniformBlock("Matrices", 0);
+	volumeUniforms.model = lightVolumeShader->uniform<glm::mat4>("model");
+	volumeUniforms.lightPos = lightVolumeShader->uniform<glm::vec3>("lightPos");
+	volumeUniforms.lightDir = lightVolumeShader->uniform<glm::vec3>("lightDir");
+	volumeUniforms.lightColor = lightVolumeShader->uniform<glm::vec3>("lightColor");
+	volumeUniforms.range = lightVolumeShader->uniform<float>("range");
+	volumeUniforms.Linear = lightVolumeShader->uniform<float>("Linear");
+	volumeUniforms.Quadratic = lightVolumeShader->uniform<float>("Quadratic");
+	volumeUniforms.shadowSlot = lightVolumeShader->uniform<float>("shadowSlot");
+	volumeUniforms.cutOff = lightVolumeShader->uniform<float>("cutOff");
+	volumeUniforms.outerCutOff = lightVolumeShader->uniform<float>("outerCutOff");
+	volumeUniforms.spot = lightVolumeShader->uniform<bool>("spot");
+
+	volumeStencilShader = std::make_unique<Shader>("src/shaders/lightvolume.vert", "src/shaders/lightvolumestencil.frag");
+	volumeStencilShader->bindUniformBlock("Matrices", 0);
+	stencilModel = volumeStencilShader->uniform<glm::mat4>("model");
 }
 
 DeferredLightingPass::~DeferredLightingPass()
 {
-	glDeleteTextures(2, &colorBuffers[0]);
-	glDeleteRenderbuffers(1, &rboDepthLighting);
-	glDeleteFramebuffers(1, &hdrFBO);
 }
 
-void DeferredLightingPass::Render()
+std::vector<std::string> DeferredLightingPass::constantDefines()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gBuffer->gPosition);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, gBuffer->gNormal);
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, gBuffer->gAlbedoSpec);
+	return {
+		"MAX_DIR_LIGHTS " + std::to_string(MAX_DIR_LIGHTS),
+		"CLUSTER_X " + std::to_string(LightClusters::GRID_X),
+		"CLUSTER_Y " + std::to_string(LightClusters::GRID_Y),
+		"CLUSTER_Z " + std::to_string(LightClusters::GRID_Z),
+		"SPOT_LIGHT_BIT " + std::to_string(LightClusters::SPOT_LIGHT_BIT) + "u",
+		"MAX_CASCADES " + std::to_string(MAX_CASCADES),
+		"POINT_SHADOW_TIERS " + std::to_string(POINT_SHADOW_TIERS),
+		"SHADOW_LAYER_BITS " + std::to_string(PointShadowPass::LAYER_BITS)
+	};
+}
 
+// SSAO and SSR follow the preprocess passes, CLUSTERED the lighting mode
+void DeferredLightingPass::selectVariant()
+{
+	lightingVariant = lightingMode == LightingMode::Clustered ? lightingPassShaders->bit("CLUSTERED") : 0;
 	for (auto& p : preprocessPasses) {
 		for (auto& output_texture : p->output_textures) {
-			glActiveTexture(GL_TEXTURE0 + output_texture.texture_unit);
-			glBindTexture(GL_TEXTURE_2D, output_texture.id);
+			std::string feature = output_texture;
+			std::transform(feature.begin(), feature.end(), feature.begin(), ::toupper);
+			lightingVariant |= lightingPassShaders->bit(feature);
 		}
 	}
+}
+
+void DeferredLightingPass::Setup(RenderGraph::Builder& builder)
+{
+	graphUnits.clear();
+	for (const char* name : { "gDepth", "gNormal", "gAlbedoSpec" }) {
+		graphUnits[name] = builder.read(name);
+		lightVolumeShader->use();
+		lightVolumeShader->setInt(name, graphUnits[name]);
+	}
+	for (auto& p : preprocessPasses)
+		for (auto& output_texture : p->output_textures)
+			graphUnits[output_texture] = builder.read(output_texture);
+	lightingPassShaders->forEach([this](Shader& shader) {
+		for (auto& unit : graphUnits)
+			shader.setInt(unit.first, unit.second);
+	});
+	selectVariant();
+
+	// light volumes test depth and mark pixels in the stencil of a copy of the G-buffer's depth, see Render()
+	gDepth = builder.use("gDepth");
+	lightingDepth = lightingMode == LightingMode::LightVolumes
+		? builder.create("lightingDepth", { GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8 })
+		: RenderGraph::NONE;
+	hdrColor = builder.create("hdrColor", { GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_LINEAR });
+	brightColor = builder.create("brightColor", { GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_LINEAR });
+}
+
+void DeferredLightingPass::Render()
+{
+	timer.begin();
+
+	// Both shaders sample gDepth, so it must not be attached here: sampling an image that is also attached is a
+	// feedback loop with undefined results, whether or not it is written. The full-screen pass needs no depth buffer,
+	// the light volumes test against a copy of the depth and write their stencil there.
+	if (lightingDepth != RenderGraph::NONE) {
+		graph->copyDepth(gDepth, lightingDepth);
+		graph->bindFramebuffer({ hdrColor, brightColor }, lightingDepth);
+		glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	}
+	else {
+		graph->bindFramebuffer({ hdrColor, brightColor });
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	lightClusters->bindTextures();
+	scene->lights.bindTextures();
+	shadowMap->bindTextures();
+	pointShadows->bindTextures();
 
-	lightingPassShader->use();
+	Shader& lightingPassShader = lightingPassShaders->select(lightingVariant);
+	lightingPassShader.use();
+	lightingPassShader.setFloat("sliceScale", lightClusters->sliceScale);
+	lightingPassShader.setFloat("sliceBias", lightClusters->sliceBias);
+	lightingPassShader.setVec2("screenSize", (float)TARGET_WIDTH, (float)TARGET_HEIGHT);
+	GLState::disable(GL_DEPTH_TEST);
 	RenderQuad();
+	GLState::enable(GL_DEPTH_TEST);
 
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer->gBuffer);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, hdrFBO); // write to default framebuffer
-	glBlitFramebuffer(0, 0, TARGET_WIDTH, TARGET_HEIGHT, 0, 0, TARGET_WIDTH, TARGET_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	if (lightingDepth != RenderGraph::NONE)
+		RenderLightVolumes();
+
+	timer.end();
+}
+
+void DeferredLightingPass::setLightingMode(LightingMode mode)
+{
+	lightingMode = mode;
+	selectVariant();
+	// only light volumes need the depth copy
+	if (graph) graph->invalidate();
+}
+
+// Point lights are drawn as spheres and spot lights as cones, sized by their attenuation range.
+// A stencil pass marks the pixels whose G-buffer depth lies inside the volume: back faces behind the surface
+// increment, front faces behind it decrement, so only pixels between the two keep a non-zero value.
+// The lighting pass then shades just those pixels additively and resets their stencil, so no clear is
+// needed between lights.
+void DeferredLightingPass::RenderLightVolumes()
+{
+	GLState::enable(GL_STENCIL_TEST);
+	GLState::depthMask(GL_FALSE);
+	glBlendEquation(GL_FUNC_ADD);
+	GLState::blendFunc(GL_ONE, GL_ONE);
+
+	lightVolumeShader->use();
+	lightVolumeShader->setVec2("screenSize", (float)TARGET_WIDTH, (float)TARGET_HEIGHT);
+
+	for (const auto& light : scene->lights.pointLights) {
+		float range = light.radius();
+		lightVolumeShader->use();
+		lightVolumeShader->set(volumeUniforms.lightPos, glm::vec3(light.pos));
+		lightVolumeShader->set(volumeUniforms.lightColor, glm::vec3(light.color));
+		lightVolumeShader->set(volumeUniforms.range, range);
+		lightVolumeShader->set(volumeUniforms.Linear, light.Linear);
+		lightVolumeShader->set(volumeUniforms.Quadratic, light.Quadratic);
+		lightVolumeShader->set(volumeUniforms.spot, false);
+		lightVolumeShader->set(volumeUniforms.shadowSlot, light.shadowSlot);
+		DrawLightVolume(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(light.pos)), glm::vec3(range)), false);
+	}
+
+	for (const auto& light : scene->lights.spotLights) {
+		float range = light.radius();
+		lightVolumeShader->use();
+		lightVolumeShader->set(volumeUniforms.lightPos, glm::vec3(light.pos));
+		lightVolumeShader->set(volumeUniforms.lightDir, glm::vec3(light.dir));
+		lightVolumeShader->set(volumeUniforms.lightColor, glm::vec3(light.color));
+		lightVolumeShader->set(volumeUniforms.range, range);
+		lightVolumeShader->set(volumeUniforms.Linear, light.Linear);
+		lightVolumeShader->set(volumeUniforms.Quadratic, light.Quadratic);
+		lightVolumeShader->set(volumeUniforms.spot, true);
+		lightVolumeShader->set(volumeUniforms.shadowSlot, -1.0f);
+		lightVolumeShader->set(volumeUniforms.cutOff, light.cutOff);
+		lightVolumeShader->set(volumeUniforms.outerCutOff, light.outerCutOff);
+
+		// very wide cones would get a huge base, a sphere is tighter
+		if (light.outerCutOff < glm::cos(glm::radians(75.0f))) {
+			DrawLightVolume(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(light.pos)), glm::vec3(range)), false);
+			continue;
+		}
+
+		// cone basis: local -z along the light direction
+		glm::vec3 forward = glm::normalize(glm::vec3(light.dir));
+		glm::vec3 up = glm::abs(forward.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 right = glm::normalize(glm::cross(forward, up));
+		up = glm::cross(right, forward);
+		float baseRadius = range * glm::tan(glm::acos(light.outerCutOff));
+		glm::mat4 model(glm::vec4(right * baseRadius, 0.0f), glm::vec4(up * baseRadius, 0.0f), glm::vec4(-forward * range, 0.0f), glm::vec4(glm::vec3(light.pos), 1.0f));
+		DrawLightVolume(model, true);
+	}
+
+	GLState::disable(GL_STENCIL_TEST);
+	GLState::disable(GL_CULL_FACE);
+	GLState::cullFace(GL_BACK);
+	GLState::depthMask(GL_TRUE);
+	GLState::enable(GL_DEPTH_TEST);
+}
+
+// expects the light's uniforms to be set on lightVolumeShader
+void DeferredLightingPass::DrawLightVolume(const glm::mat4& model, bool cone)
+{
+	// stencil pass
+	volumeStencilShader->use();
+	volumeStencilShader->set(stencilModel, model);
+	GLState::colorMask(GL_FALSE);
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::disable(GL_CULL_FACE);
+	glStencilFunc(GL_ALWAYS, 0, 0);
+	glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+	glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+	if (cone) RenderCone(); else RenderSphere();
+
+	// lighting pass, back faces so the volume still covers its pixels with the camera inside it
+	lightVolumeShader->use();
+	lightVolumeShader->set(volumeUniforms.model, model);
+	GLState::colorMask(GL_TRUE);
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::enable(GL_CULL_FACE);
+	GLState::cullFace(GL_FRONT);
+	glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+	GLState::enable(GL_BLEND);
+	if (cone) RenderCone(); else RenderSphere();
+	GLState::disable(GL_BLEND);
 }
 
 void DeferredLightingPass::ResizeBuffers(unsigned int width, unsigned int height)
 {
 	TARGET_WIDTH = width; TARGET_HEIGHT = height;
-	for (unsigned int i = 0; i < 2; i++) {
-		glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	}
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepthLighting);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, TARGET_WIDTH, TARGET_HEIGHT);
 }
 
+// the outputs are read and their variant selected in Setup(), which the graph runs again before the next frame
 void DeferredLightingPass::AddPreprocessPass(std::shared_ptr<PreprocessPass> preprocessPass)
 {
 	preprocessPasses.push_back(preprocessPass);
-	lightingPassShader->use();
-	for (auto& output_texture : preprocessPass->output_textures) {
-		lightingPassShader->setInt(output_texture.name, output_texture.texture_unit);
-		lightingPassShader->setBool(output_texture.name + "On", true);
-	}
+	graph->addPass(preprocessPass->name, preprocessPass);
 }
 
 void DeferredLightingPass::RemovePreprocessPass(std::shared_ptr<PreprocessPass> preprocessPass)
 {
-	lightingPassShader->use();
-	for (auto& output_texture : preprocessPass->output_textures)
-		lightingPassShader->setBool(output_texture.name + "On", false);
-
 	preprocessPasses.erase(std::remove(preprocessPasses.begin(), preprocessPasses.end(), preprocessPass));
+	selectVariant();
+	graph->removePass(preprocessPass);
 }
@@ -2,26 +2,63 @@
 #define DEFERRED_LIGHTING_H
 
 #include "renderpass.h"
+#include "shadervariants.h"
 #include "preprocesspass.h"
-#include "gbuffer.h"
+#include "lightclusters.h"
+#include "shadowmap.h"
+#include "pointshadows.h"
+#include "gputimer.h"
+#include "scene.h"
 
 class DeferredLightingPass : public RenderPass
 {
 private:
-	std::unique_ptr<Shader> lightingPassShader;
-	std::shared_ptr<GBufferPass> gBuffer;
+	// variants: SSAO and SSR when their preprocess pass runs, CLUSTERED in the clustered lighting mode
+	std::unique_ptr<ShaderVariants> lightingPassShaders;
+	unsigned int lightingVariant = 0;
+	std::map<std::string, int> graphUnits; // sampler units of the render graph's textures, set on every variant
+	std::unique_ptr<Shader> lightVolumeShader;
+	std::unique_ptr<Shader> volumeStencilShader;
+	// set for every light
+	struct {
+		Shader::Uniform<glm::mat4> model;
+		Shader::Uniform<glm::vec3> lightPos, lightDir, lightColor;
+		Shader::Uniform<float> range, Linear, Quadratic, shadowSlot, cutOff, outerCutOff;
+		Shader::Uniform<bool> spot;
+	} volumeUniforms;
+	Shader::Uniform<glm::mat4> stencilModel;
+	RenderGraph::Resource gDepth, lightingDepth = RenderGraph::NONE, hdrColor, brightColor;
+	std::shared_ptr<LightClusters> lightClusters;
+	std::shared_ptr<ShadowMapPass> shadowMap;
+	std::shared_ptr<PointShadowPass> pointShadows;
+	std::shared_ptr<Scene> scene;
+
+	void selectVariant();
+	void RenderLightVolumes();
+	void DrawLightVolume(const glm::mat4& model, bool cone);
 public:
-	unsigned int hdrFBO;
-	unsigned int colorBuffers[2];
-	unsigned int rboDepthLighting;
+	// Clustered shades every point and spot light in the full-screen pass, LightVolumes draws them as stencil
+	// masked spheres and cones so their cost scales with the pixels they cover
+	enum class LightingMode {
+		Clustered, LightVolumes
+	};
+	LightingMode lightingMode = LightingMode::Clustered;
+	void setLightingMode(LightingMode mode);
+
+	GpuTimer timer;
 
 	std::vector<std::shared_ptr<PreprocessPass>> preprocessPasses;
 
-	DeferredLightingPass(unsigned int width, unsigned int height, std::shared_ptr<GBufferPass> gBuffer);
+	// the light, cluster and shadow limits of the C++ side, compiled into the lighting shaders
+	static std::vector<std::string> constantDefines();
+
+	DeferredLightingPass(unsigned int width, unsigned int height, std::shared_ptr<LightClusters> lightClusters, std::shared_ptr<ShadowMapPass> shadowMap, std::shared_ptr<PointShadowPass> pointShadows, std::shared_ptr<Scene> scene);
 	~DeferredLightingPass();
+	void Setup(RenderGraph::Builder& builder) override;
 	void Render() override;
 	void ResizeBuffers(unsigned int width, unsigned int height) override;
 
+	// also adds the pass to the render graph, or removes it
 	void AddPreprocessPass(std::shared_ptr<PreprocessPass> preprocessPass);
 	void RemovePreprocessPass(std::shared_ptr<PreprocessPass> preprocessPass);
 };
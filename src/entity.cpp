@@ -1,56 +1,33 @@
 #include "entity.h"
 
-unsigned int Entity::entityCount = 0;
+#include <cstdio>
 
-Entity::Entity() {
-	this->id = generateID();
-	char entity_name[128];
-	snprintf(entity_name, 128, "Entity %d", entityCount++);
-	strncpy_s(this->name, entity_name, 128);
+std::vector<Entity> Entity::children() {
+	std::vector<Entity> result;
+	for (auto child : registry->children(handle))
+		result.push_back(Entity(registry, child));
+	return result;
 }
 
-Entity::Entity(std::string modelPath) {
-	this->id = generateID();
-	char entity_name[128];
-	snprintf(entity_name, 128, "Entity %d", entityCount++);
-	strncpy_s(this->name, entity_name, 128);
-	this->model = Model::loadModel(modelPath);
+Entity Entity::addChild() {
+	return Entity(registry, registry->create(handle));
 }
 
-Entity::Entity(char name[128], std::string modelPath) {
-	this->id = generateID();
-	strncpy_s(this->name, name, 128);
-	this->model = Model::loadModel(modelPath);
+Entity Entity::addChild(std::string modelPath) {
+	return Entity(registry, registry->create(handle, nullptr, Model::loadModel(modelPath).get()));
 }
 
-void Entity::updateTransformMatrix() {
-	if (transform.isDirty()) {
-		forceUpdateTransformMatrix();
-		return;
-	}
-
-	for (auto&& child : children) child->updateTransformMatrix();
-}
-
-void Entity::forceUpdateTransformMatrix() {
-	if (parent)
-		transform.computeModelMatrix(parent->transform.getModelMatrix());
-	else
-		transform.computeModelMatrix();
-
-	for (auto&& child : children) child->forceUpdateTransformMatrix();
-}
-
-void Entity::renderUI(size_t& node_clicked, Entity*& selected_entity) {
+void Entity::renderUI(EntityHandle& node_clicked, Entity& selected_entity) {
+	std::vector<Entity> childEntities = children();
 	ImGuiTreeNodeFlags flags = base_flags;
-	if (children.size() == 0) flags |= ImGuiTreeNodeFlags_Leaf;
-	if (id == node_clicked) flags |= ImGuiTreeNodeFlags_Selected;
+	if (childEntities.size() == 0) flags |= ImGuiTreeNodeFlags_Leaf;
+	if (handle == node_clicked) flags |= ImGuiTreeNodeFlags_Selected;
 
-	bool node_open = ImGui::TreeNodeEx((std::string(name) + "###" + std::to_string(id)).c_str(), flags);
-	if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen()) { node_clicked = id; selected_entity = this; }
-	if (id == node_clicked)	renderEntityInfoUI();
+	bool node_open = ImGui::TreeNodeEx((name() + "###" + std::to_string(handle.index)).c_str(), flags);
+	if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen()) { node_clicked = handle; selected_entity = *this; }
+	if (handle == node_clicked)	renderEntityInfoUI();
 	if (node_open) {
-		for (auto& child : children) child->renderUI(node_clicked, selected_entity);
+		for (auto& child : childEntities) child.renderUI(node_clicked, selected_entity);
 		ImGui::TreePop();
 	}
 }
@@ -58,10 +35,19 @@ void Entity::renderUI(size_t& node_clicked, Entity*& selected_entity) {
 void Entity::renderEntityInfoUI() {
 	ImGui::Begin("Entity info");
 
-	ImGui::InputText("Name", name, 128);
+	char nameBuffer[128];
+	snprintf(nameBuffer, sizeof(nameBuffer), "%s", name().c_str());
+	if (ImGui::InputText("Name", nameBuffer, sizeof(nameBuffer)))
+		registry->setName(handle, nameBuffer);
+	if (registry->parent(handle) != EntityHandle()) {
+		ImGui::SameLine();
+		if (ImGui::Button("Delete")) registry->destroy(handle);
+	}
+	bool staticEntity = isStatic();
+	if (ImGui::Checkbox("Static", &staticEntity)) setStatic(staticEntity);
 	ImGui::Spacing();
-	transform.renderUI();
-	model->renderUI();
+	transform().renderUI();
+	if (Model* m = model()) m->renderUI();
 
 	ImGui::End();
-}
\ No newline at end of file
+}
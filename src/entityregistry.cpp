@@ -0,0 +1,256 @@
+#include "entityregistry.h"
+
+#include <algorithm>
+#include <cstring>
+
+const unsigned int EntityRegistry::noName;
+
+EntityHandle EntityRegistry::create(EntityHandle parent, const char* name, Model* model)
+{
+	EntityHandle handle;
+	spawn(parent, 1, model, &handle);
+	if (name) setName(handle, name);
+	return handle;
+}
+
+// Spawns count unnamed children of parent. Rows, slots and transform nodes are allocated for the whole batch at once.
+void EntityRegistry::spawnBatch(EntityHandle parent, unsigned int count, Model* model, std::vector<EntityHandle>& handlesOut)
+{
+	size_t first = handlesOut.size();
+	handlesOut.resize(first + count);
+	if (count > 0) spawn(parent, count, model, &handlesOut[first]);
+}
+
+void EntityRegistry::spawn(EntityHandle parent, unsigned int count, Model* model, EntityHandle* handlesOut)
+{
+	unsigned int parentTransform = alive(parent) ? transform(parent) : TransformHierarchy::invalid;
+	// most of a scene never moves, so entities start out static
+	unsigned int mask = COMPONENT_TRANSFORM | COMPONENT_NAME | COMPONENT_STATIC | (model ? COMPONENT_MODEL : 0);
+	unsigned int archetype = archetypeFor(mask);
+	unsigned int row = addRows(archetype, count);
+	Archetype& a = archetypes[archetype];
+
+	transforms->addBatch(parentTransform, count, &a.transforms[row]);
+	unsigned int maxTransform = *std::max_element(a.transforms.begin() + row, a.transforms.end());
+	if (transformOwners.size() <= maxTransform) transformOwners.resize(maxTransform + 1);
+
+	for (unsigned int i = 0; i < count; i++) {
+		EntityHandle handle;
+		if (!freeSlots.empty()) {
+			handle.index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			handle.index = (unsigned int)slots.size();
+			slots.push_back({ 0, 0, 0 });
+		}
+		Slot& slot = slots[handle.index];
+		handle.generation = slot.generation;
+		slot.archetype = archetype;
+		slot.row = row + i;
+
+		a.entities[row + i] = handle;
+		if (model) a.models[row + i] = model;
+		transformOwners[a.transforms[row + i]] = handle;
+		handlesOut[i] = handle;
+	}
+}
+
+void EntityRegistry::destroy(EntityHandle handle)
+{
+	if (alive(handle)) pendingDestroy.push_back(handle);
+}
+
+// Removes every entity queued by destroy() together with its descendants. The transform hierarchy is compacted once
+// for the whole batch, rows are swap-removed and slots get a new generation so old handles stop resolving.
+void EntityRegistry::flush()
+{
+	if (pendingDestroy.empty()) return;
+
+	std::vector<unsigned int> roots, removed;
+	roots.reserve(pendingDestroy.size());
+	for (auto handle : pendingDestroy)
+		if (alive(handle)) roots.push_back(transform(handle));
+	pendingDestroy.clear();
+
+	transforms->remove(roots, removed);
+	for (unsigned int t : removed) {
+		EntityHandle handle = transformOwners[t];
+		transformOwners[t] = EntityHandle();
+		Slot& slot = slots[handle.index];
+		Archetype& a = archetypes[slot.archetype];
+		unsigned int nameOffset = a.names[slot.row];
+		if (nameOffset != noName) nameGarbage += strlen(&nameArena[nameOffset]) + 1;
+		if ((a.mask & COMPONENT_MODEL) && (a.mask & COMPONENT_STATIC)) removedStaticBounds.push_back(a.bounds[slot.row]);
+
+		removeRow(slot.archetype, slot.row);
+		slot.generation++;
+		freeSlots.push_back(handle.index);
+	}
+
+	if (nameGarbage > nameArena.size() / 2) compactNames();
+}
+
+bool EntityRegistry::alive(EntityHandle handle) const
+{
+	return handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+}
+
+Model* EntityRegistry::model(EntityHandle handle)
+{
+	Archetype& a = archetypeOf(handle);
+	return (a.mask & COMPONENT_MODEL) ? a.models[rowOf(handle)] : nullptr;
+}
+
+void EntityRegistry::setModel(EntityHandle handle, Model* model)
+{
+	Slot& slot = slots[handle.index];
+	unsigned int oldMask = archetypes[slot.archetype].mask;
+	unsigned int newMask = model ? (oldMask | COMPONENT_MODEL) : (oldMask & ~COMPONENT_MODEL);
+	if (newMask != oldMask) moveToArchetype(handle, newMask);
+	if (model) archetypes[slot.archetype].models[slot.row] = model;
+	// the bounds change with the model, dirtying the transform makes caches see it
+	transforms->dirty[transforms->node(transform(handle))] = true;
+}
+
+void EntityRegistry::setStatic(EntityHandle handle, bool isStatic)
+{
+	unsigned int oldMask = archetypeOf(handle).mask;
+	unsigned int newMask = isStatic ? (oldMask | COMPONENT_STATIC) : (oldMask & ~COMPONENT_STATIC);
+	if (newMask == oldMask) return;
+	if (!isStatic && (oldMask & COMPONENT_MODEL)) removedStaticBounds.push_back(archetypeOf(handle).bounds[rowOf(handle)]);
+	moveToArchetype(handle, newMask);
+	transforms->dirty[transforms->node(transform(handle))] = true;
+}
+
+// Changing the component set moves the entity's row to another archetype. The transform node stays put,
+// so this is a swap-remove and an append per column.
+void EntityRegistry::moveToArchetype(EntityHandle handle, unsigned int mask)
+{
+	Slot& slot = slots[handle.index];
+	unsigned int archetype = archetypeFor(mask);
+	unsigned int row = addRows(archetype, 1);
+	Archetype& from = archetypes[slot.archetype];
+	Archetype& to = archetypes[archetype];
+	to.entities[row] = handle;
+	to.transforms[row] = from.transforms[slot.row];
+	to.names[row] = from.names[slot.row];
+	if ((from.mask & COMPONENT_MODEL) && (to.mask & COMPONENT_MODEL)) {
+		to.models[row] = from.models[slot.row];
+		to.bounds[row] = from.bounds[slot.row];
+	}
+
+	removeRow(slot.archetype, slot.row);
+	slot.archetype = archetype;
+	slot.row = row;
+}
+
+std::string EntityRegistry::name(EntityHandle handle)
+{
+	unsigned int offset = archetypeOf(handle).names[rowOf(handle)];
+	if (offset == noName) return "Entity " + std::to_string(handle.index);
+	return std::string(&nameArena[offset]);
+}
+
+// Shorter names are overwritten in place, longer ones are appended to the arena and leave the old string as garbage
+void EntityRegistry::setName(EntityHandle handle, const char* name)
+{
+	unsigned int& offset = archetypeOf(handle).names[rowOf(handle)];
+	size_t length = strlen(name);
+	if (offset != noName) {
+		size_t oldLength = strlen(&nameArena[offset]);
+		if (length <= oldLength) {
+			memcpy(&nameArena[offset], name, length + 1);
+			nameGarbage += oldLength - length;
+			return;
+		}
+		nameGarbage += oldLength + 1;
+	}
+	offset = (unsigned int)nameArena.size();
+	nameArena.insert(nameArena.end(), name, name + length + 1);
+}
+
+void EntityRegistry::compactNames()
+{
+	std::vector<char> arena;
+	arena.reserve(nameArena.size() - nameGarbage);
+	for (auto& a : archetypes) {
+		for (auto& offset : a.names) {
+			if (offset == noName) continue;
+			const char* name = &nameArena[offset];
+			offset = (unsigned int)arena.size();
+			arena.insert(arena.end(), name, name + strlen(name) + 1);
+		}
+	}
+	nameArena.swap(arena);
+	nameGarbage = 0;
+}
+
+EntityHandle EntityRegistry::parent(EntityHandle handle)
+{
+	unsigned int node = transforms->node(transform(handle));
+	unsigned int parentNode = transforms->parents[node];
+	if (parentNode == TransformHierarchy::invalid) return EntityHandle();
+	return transformOwners[transforms->handle(parentNode)];
+}
+
+// children are the subtrees directly following the node in the depth-first transform order
+std::vector<EntityHandle> EntityRegistry::children(EntityHandle handle)
+{
+	std::vector<EntityHandle> result;
+	unsigned int node = transforms->node(transform(handle));
+	unsigned int end = node + transforms->subtreeSizes[node];
+	for (unsigned int child = node + 1; child < end; child += transforms->subtreeSizes[child])
+		result.push_back(transformOwners[transforms->handle(child)]);
+	return result;
+}
+
+unsigned int EntityRegistry::archetypeFor(unsigned int mask)
+{
+	for (unsigned int i = 0; i < archetypes.size(); i++)
+		if (archetypes[i].mask == mask) return i;
+
+	archetypes.emplace_back();
+	archetypes.back().mask = mask;
+	return (unsigned int)archetypes.size() - 1;
+}
+
+// appends count default-initialised rows to every column of the archetype and returns the first
+unsigned int EntityRegistry::addRows(unsigned int archetype, unsigned int count)
+{
+	Archetype& a = archetypes[archetype];
+	size_t size = a.size();
+	a.entities.resize(size + count);
+	if (a.mask & COMPONENT_TRANSFORM) a.transforms.resize(size + count, TransformHierarchy::invalid);
+	if (a.mask & COMPONENT_MODEL) {
+		a.models.resize(size + count, nullptr);
+		a.bounds.resize(size + count, AABB());
+	}
+	if (a.mask & COMPONENT_NAME) a.names.resize(size + count, noName);
+	return (unsigned int)size;
+}
+
+// swap-remove: the last row fills the hole and its slot is pointed at the new row
+void EntityRegistry::removeRow(unsigned int archetype, unsigned int row)
+{
+	Archetype& a = archetypes[archetype];
+	unsigned int last = (unsigned int)a.size() - 1;
+	if (row != last) {
+		a.entities[row] = a.entities[last];
+		if (a.mask & COMPONENT_TRANSFORM) a.transforms[row] = a.transforms[last];
+		if (a.mask & COMPONENT_MODEL) {
+			a.models[row] = a.models[last];
+			a.bounds[row] = a.bounds[last];
+		}
+		if (a.mask & COMPONENT_NAME) a.names[row] = a.names[last];
+		slots[a.entities[row].index].row = row;
+	}
+
+	a.entities.pop_back();
+	if (a.mask & COMPONENT_TRANSFORM) a.transforms.pop_back();
+	if (a.mask & COMPONENT_MODEL) {
+		a.models.pop_back();
+		a.bounds.pop_back();
+	}
+	if (a.mask & COMPONENT_NAME) a.names.pop_back();
+}
@@ -0,0 +1,99 @@
+#ifndef ENTITY_REGISTRY_H
+#define ENTITY_REGISTRY_H
+
+#include <climits>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "model.h"
+#include "transform.h"
+
+struct EntityHandle {
+	unsigned int index = UINT_MAX;
+	unsigned int generation = 0;
+
+	bool operator==(const EntityHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+enum ComponentBits : unsigned int {
+	COMPONENT_TRANSFORM = 1 << 0,
+	COMPONENT_NAME = 1 << 1,
+	COMPONENT_MODEL = 1 << 2, // model reference and world-space bounds
+	COMPONENT_STATIC = 1 << 3, // tag without data: the entity rarely moves, so shadow maps may cache it
+};
+
+// All entities with the same set of components. Every component is a contiguous column indexed by row,
+// so systems scan only the columns they need. Transforms and world matrices live in the TransformHierarchy,
+// the transform column holds the node handles.
+struct Archetype {
+	unsigned int mask;
+	std::vector<EntityHandle> entities;
+
+	// hot
+	std::vector<unsigned int> transforms;
+	std::vector<Model*> models;
+	std::vector<AABB> bounds;
+
+	// cold, offsets into the registry's name arena
+	std::vector<unsigned int> names;
+
+	size_t size() const { return entities.size(); }
+};
+
+// Owns entity components in archetype tables. Handles stay valid across structural changes:
+// a slot maps the handle to its current archetype and row, and its generation detects stale handles.
+// Destruction is deferred: destroy() queues the entity and flush() removes all queued entities at once.
+class EntityRegistry {
+private:
+	struct Slot {
+		unsigned int generation;
+		unsigned int archetype;
+		unsigned int row;
+	};
+	std::vector<Slot> slots;
+	std::vector<unsigned int> freeSlots;
+	std::vector<EntityHandle> pendingDestroy;
+
+	// names are stored out of line, entities without a name have no storage at all
+	static const unsigned int noName = UINT_MAX;
+	std::vector<char> nameArena;
+	size_t nameGarbage = 0;
+	void compactNames();
+
+	unsigned int archetypeFor(unsigned int mask);
+	unsigned int addRows(unsigned int archetype, unsigned int count);
+	void removeRow(unsigned int archetype, unsigned int row);
+	void moveToArchetype(EntityHandle handle, unsigned int mask);
+	void spawn(EntityHandle parent, unsigned int count, Model* model, EntityHandle* handlesOut);
+
+public:
+	TransformHierarchy* transforms;
+	std::vector<Archetype> archetypes;
+	std::vector<EntityHandle> transformOwners; // entity owning each transform handle
+	std::vector<AABB> removedStaticBounds;     // static models destroyed or made dynamic, consumed by the RenderList
+
+	EntityRegistry(TransformHierarchy* transforms) : transforms(transforms) {}
+
+	EntityHandle create(EntityHandle parent, const char* name = nullptr, Model* model = nullptr);
+	void spawnBatch(EntityHandle parent, unsigned int count, Model* model, std::vector<EntityHandle>& handlesOut);
+	void destroy(EntityHandle handle);
+	void flush();
+	bool alive(EntityHandle handle) const;
+	size_t size() const { return slots.size() - freeSlots.size(); }
+	void setModel(EntityHandle handle, Model* model);
+	bool isStatic(EntityHandle handle) { return (archetypeOf(handle).mask & COMPONENT_STATIC) != 0; }
+	void setStatic(EntityHandle handle, bool isStatic);
+
+	Archetype& archetypeOf(EntityHandle handle) { return archetypes[slots[handle.index].archetype]; }
+	unsigned int rowOf(EntityHandle handle) const { return slots[handle.index].row; }
+
+	std::string name(EntityHandle handle);
+	void setName(EntityHandle handle, const char* name);
+	unsigned int transform(EntityHandle handle) { return archetypeOf(handle).transforms[rowOf(handle)]; }
+	Model* model(EntityHandle handle);
+	EntityHandle parent(EntityHandle handle);
+	std::vector<EntityHandle> children(EntityHandle handle);
+};
+#endif
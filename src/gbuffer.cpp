@@ -1,102 +1,125 @@
 #include "gbuffer.h"
 
-GBufferPass::GBufferPass(unsigned int width, unsigned int height, std::shared_ptr<Scene> scene) : RenderPass(width, height)
-{
-	this->scene = scene;
-
-	// gBuffer
-	glGenFramebuffers(1, &gBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-
-	// - position color buffer
-	glGenTextures(1, &gPosition);
-	glBindTexture(GL_TEXTURE_2D, gPosition);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-	// - normal color buffer
-	glGenTextures(1, &gNormal);
-	glBindTexture(GL_TEXTURE_2D, gNormal);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-
-	// - color + specular color buffer
-	glGenTextures(1, &gAlbedoSpec);
-	glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
-
-	// - tell OpenGL which color attachments we'll use (of this framebuffer) for rendering 
-	unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-	glDrawBuffers(3, attachments);
-	// create and attach depth buffer (renderbuffer)
-	glGenRenderbuffers(1, &rboDepthGBuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepthGBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, TARGET_WIDTH, TARGET_HEIGHT);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepthGBuffer);
-	// finally check if framebuffer is complete
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer not complete!" << std::endl;
+#include <imgui/imgui.h>
 
-	// set shader parameters
-	gBufferShader = std::make_unique<Shader>("src/shaders/gbuffer.vert", "src/shaders/gbuffer.frag");
+#include <chrono>
 
-	gBufferShader->use();
-	gBufferShader->setInt("texture_diffuse", 0);
-	gBufferShader->setInt("texture_specular", 1);
-	gBufferShader->setInt("normal_map", 2);
+GBufferPass::GBufferPass(unsigned int width, unsigned int height, std::shared_ptr<RenderList> renderList) : RenderPass(width, height)
+{
+	this->renderList = renderList;
 
-	// bind matrix uniform block
-	gBufferShader->bindUniformBlock("Matrices", 0);
+	// set shader parameters
+	gBufferShaders = std::make_unique<ShaderVariants>("src/shaders/gbuffer.vert", "src/shaders/gbuffer.frag",
+		std::vector<std::string>{ "NORMAL_MAP" }, std::vector<std::string>{}, [](Shader& shader) {
+			shader.setInt("texture_diffuse", 0);
+			shader.setInt("texture_specular", 1);
+			shader.setInt("normal_map", 2);
+
+			// bind matrix uniform blocks
+			shader.bindUniformBlock("Matrices", 0);
+			shader.bindUniformBlock("Object", RenderList::OBJECT_BINDING);
+		});
+	// without a normal map now, with one in the background; until then those items fall back to the vertex normals
+	gBufferShaders->get(0);
+	gBufferShaders->prewarmAll();
+
+	prepassShader = std::make_unique<Shader>("src/shaders/depthprepass.vert", "src/shaders/depthshader.frag");
+	prepassShader->bindUniformBlock("Matrices", 0);
+	prepassShader->bindUniformBlock("Object", RenderList::OBJECT_BINDING);
 }
 
 GBufferPass::~GBufferPass() {
-	glDeleteTextures(1, &gPosition);
-	glDeleteTextures(1, &gNormal);
-	glDeleteTextures(1, &gAlbedoSpec);
-
-	glDeleteRenderbuffers(1, &rboDepthGBuffer);
+}
 
-	glDeleteFramebuffers(1, &gBuffer);
+void GBufferPass::Setup(RenderGraph::Builder& builder)
+{
+	// depth is sampled to reconstruct the view space position, normals are octahedral, see shaders/gbuffer.glsl
+	gDepth = builder.create("gDepth", { GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8 });
+	gNormal = builder.create("gNormal", { GL_RG16, GL_RG, GL_UNSIGNED_SHORT });
+	gAlbedoSpec = builder.create("gAlbedoSpec", { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE });
 }
 
 void GBufferPass::Render()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+	if (prepassMode == PrepassMode::Auto) {
+		// hysteresis so the prepass does not toggle every frame around the threshold
+		if (overdraw > prepassThreshold + prepassHysteresis) prepassActive = true;
+		else if (overdraw < prepassThreshold - prepassHysteresis) prepassActive = false;
+	}
+	else {
+		prepassActive = prepassMode == PrepassMode::On;
+	}
+
+	timer.begin();
+	graph->bindFramebuffer({ gNormal, gAlbedoSpec }, gDepth);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glCullFace(GL_BACK);
+	GLState::cullFace(GL_BACK);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	fragmentCounter.begin();
+	if (prepassActive) {
+		drawPrepass();
+		fragmentCounter.end();
+		GLState::depthFunc(GL_EQUAL);
+		GLState::depthMask(GL_FALSE);
+		drawGBuffer();
+		GLState::depthMask(GL_TRUE);
+		GLState::depthFunc(GL_LEQUAL);
+	}
+	else {
+		drawGBuffer();
+		fragmentCounter.end();
+	}
+	submitTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	timer.end();
 
-	gBufferShader->use();
-	for (auto&& entity : scene->root->children) {
-		entity->updateTransformMatrix();
-		renderEntityToGBuffer(*entity);
+	overdraw = fragmentCounter.lastCount / (float)(TARGET_WIDTH * TARGET_HEIGHT);
+}
+
+void GBufferPass::drawPrepass()
+{
+	GLState::colorMask(GL_FALSE);
+	prepassShader->use();
+	for (unsigned int i : renderList->visible) {
+		renderList->bindObject(i);
+		renderList->items[i].mesh->DrawDepth();
 	}
+	GLState::colorMask(GL_TRUE);
 }
 
-void GBufferPass::renderEntityToGBuffer(Entity& entity) {
-	gBufferShader->setMat4("model", entity.transform.getModelMatrix());
-	entity.model->Draw();
-	for (auto&& child : entity.children) {
-		renderEntityToGBuffer(*child);
+// one run over the visible items per variant, so the program changes once instead of with every material
+void GBufferPass::drawGBuffer()
+{
+	for (bool normalMapped : { false, true }) {
+		Shader& gBufferShader = gBufferShaders->select(normalMapped ? gBufferShaders->bit("NORMAL_MAP") : 0);
+		gBufferShader.use();
+		for (unsigned int i : renderList->visible) {
+			RenderItem& item = renderList->items[i];
+			// a normal map that failed to load or is still uploading has no storage and samples as 0
+			bool hasNormalMap = item.material->normal_map && item.material->normal_map->id != 0;
+			if (hasNormalMap != normalMapped) continue;
+			renderList->bindObject(i);
+			item.mesh->Draw();
+		}
 	}
 }
 
 void GBufferPass::ResizeBuffers(unsigned int width, unsigned int height)
 {
 	TARGET_WIDTH = width; TARGET_HEIGHT = height;
-	glBindTexture(GL_TEXTURE_2D, gPosition);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glBindTexture(GL_TEXTURE_2D, gNormal);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepthGBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, TARGET_WIDTH, TARGET_HEIGHT);
+}
+
+void GBufferPass::renderUI()
+{
+	int mode = (int)prepassMode;
+	ImGui::Text("Depth prepass");
+	ImGui::SameLine(); ImGui::RadioButton("Off", &mode, (int)PrepassMode::Off);
+	ImGui::SameLine(); ImGui::RadioButton("On", &mode, (int)PrepassMode::On);
+	ImGui::SameLine(); ImGui::RadioButton("Auto", &mode, (int)PrepassMode::Auto);
+	prepassMode = (PrepassMode)mode;
+	if (prepassMode == PrepassMode::Auto)
+		ImGui::SliderFloat("Prepass above overdraw", &prepassThreshold, 1.0f, 4.0f);
+	ImGui::Text("Overdraw %.2f fragments/pixel, prepass %s", overdraw, prepassActive ? "on" : "off");
+	ImGui::Text("G-buffer pass (GPU): %.3f ms, draw submission (CPU): %.3f ms", timer.lastTime, submitTime);
+	ImGui::Text("%u bytes per pixel (%u with position and normals in RGBA16F)", BYTES_PER_PIXEL, LEGACY_BYTES_PER_PIXEL);
 }
@@ -2,25 +2,54 @@
 #define GBUFFER_H
 
 #include "renderpass.h"
-#include "scene.h"
+#include "shadervariants.h"
+#include "renderlist.h"
+#include "gputimer.h"
+#include "samplecounter.h"
 
+// With the depth prepass the visible items are first drawn depth-only from their position streams, then the
+// G-buffer is drawn with GL_EQUAL and depth writes off, so every pixel is textured and written exactly once.
+// The prepass pays off when many fragments are overwritten later. In Auto mode the pass counts the fragments that
+// pass the depth test on the first draw of the frame (the prepass when it runs, the G-buffer draw otherwise), which is
+// the number of fragments the G-buffer would shade without a prepass, and turns the prepass on above prepassThreshold
+// fragments per pixel.
 class GBufferPass : public RenderPass
 {
 private:
-	std::shared_ptr<Scene> scene;
-	std::unique_ptr<Shader> gBufferShader;
+	std::shared_ptr<RenderList> renderList;
+	std::unique_ptr<ShaderVariants> gBufferShaders; // NORMAL_MAP for materials with a normal map
+	std::unique_ptr<Shader> prepassShader;
+	SampleCounter fragmentCounter;
+
+	void drawPrepass();
+	void drawGBuffer();
 
 public:
-	unsigned int gBuffer;
-	unsigned int gPosition, gNormal, gAlbedoSpec;
-	unsigned int rboDepthGBuffer;
+	enum class PrepassMode { Off, On, Auto };
+
+	// settings
+	PrepassMode prepassMode = PrepassMode::Auto;
+	float prepassThreshold = 1.5f; // fragments per pixel
+	float prepassHysteresis = 0.2f;
+
+	// stats
+	bool prepassActive = false;
+	float overdraw = 0.0f; // fragments passing the first depth test per pixel, a few frames old
+	float submitTime = 0.0f; // ms on the CPU issuing the draws
+	GpuTimer timer;
+
+	// G-buffer textures, from the render graph. Later passes read them as "gDepth", "gNormal" and "gAlbedoSpec".
+	RenderGraph::Resource gDepth, gNormal, gAlbedoSpec;
 
-	GBufferPass(unsigned int width, unsigned int height, std::shared_ptr<Scene> scene);
+	// depth24 stencil8 + RG16 + RGBA8, the layout before position was reconstructed from depth added two RGBA16F targets
+	static const unsigned int BYTES_PER_PIXEL = 4 + 4 + 4;
+	static const unsigned int LEGACY_BYTES_PER_PIXEL = 4 + 8 + 8 + 4;
+
+	GBufferPass(unsigned int width, unsigned int height, std::shared_ptr<RenderList> renderList);
 	~GBufferPass();
+	void Setup(RenderGraph::Builder& builder) override;
 	void Render() override;
 	void ResizeBuffers(unsigned int width, unsigned int height) override;
-
-private:
-	void renderEntityToGBuffer(Entity& entity);
+	void renderUI();
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "glstate.h"
+
+GLState::Counts GLState::frame, GLState::lastFrame;
+bool GLState::filtering = true;
+GLuint GLState::program, GLState::vao, GLState::drawFbo, GLState::readFbo;
+unsigned int GLState::activeUnit;
+GLuint GLState::textures[GLState::MAX_UNITS][GLState::TARGETS];
+GLuint GLState::caps[GLState::CAPS];
+GLuint GLState::depthWrite, GLState::colorWrite, GLState::depthCompare, GLState::culledFace, GLState::blendSrc, GLState::blendDst;
+
+namespace {
+	// sets everything to unknown before the first call
+	struct Init { Init() { GLState::invalidate(); } } init;
+}
+
+void GLState::newFrame()
+{
+	lastFrame = frame;
+	frame = Counts();
+}
+
+void GLState::invalidate()
+{
+	program = vao = drawFbo = readFbo = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (auto& unit : textures)
+		for (GLuint& texture : unit)
+			texture = UNKNOWN;
+	for (GLuint& cap : caps)
+		cap = UNKNOWN;
+	depthWrite = colorWrite = depthCompare = culledFace = blendSrc = blendDst = UNKNOWN;
+}
+
+bool GLState::change(GLuint& cached, GLuint value)
+{
+	if (filtering && cached == value) {
+		frame.filtered++;
+		return false;
+	}
+	cached = value;
+	frame.issued++;
+	return true;
+}
+
+int GLState::targetIndex(GLenum target)
+{
+	switch (target) {
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_CUBE_MAP: return 2;
+	case GL_TEXTURE_CUBE_MAP_ARRAY: return 3;
+	case GL_TEXTURE_BUFFER: return 4;
+	default: return -1;
+	}
+}
+
+int GLState::capIndex(GLenum cap)
+{
+	switch (cap) {
+	case GL_BLEND: return 0;
+	case GL_DEPTH_TEST: return 1;
+	case GL_CULL_FACE: return 2;
+	case GL_STENCIL_TEST: return 3;
+	case GL_DEPTH_CLAMP: return 4;
+	case GL_POLYGON_OFFSET_FILL: return 5;
+	default: return -1;
+	}
+}
+
+void GLState::useProgram(GLuint program)
+{
+	if (change(GLState::program, program)) glUseProgram(program);
+}
+
+void GLState::bindVertexArray(GLuint vao)
+{
+	if (change(GLState::vao, vao)) glBindVertexArray(vao);
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint fbo)
+{
+	if (target == GL_FRAMEBUFFER) {
+		if (filtering && drawFbo == fbo && readFbo == fbo) {
+			frame.filtered++;
+			return;
+		}
+		drawFbo = readFbo = fbo;
+		frame.issued++;
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	}
+	else if (change(target == GL_DRAW_FRAMEBUFFER ? drawFbo : readFbo, fbo)) {
+		glBindFramebuffer(target, fbo);
+	}
+}
+
+void GLState::activeTexture(unsigned int unit)
+{
+	if (change(activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, GLuint texture)
+{
+	int index = targetIndex(target);
+	if (unit >= MAX_UNITS || index < 0) {
+		activeUnit = UNKNOWN;
+		frame.issued += 2;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		return;
+	}
+	if (filtering && textures[unit][index] == texture) {
+		frame.filtered++;
+		return;
+	}
+	activeTexture(unit);
+	change(textures[unit][index], texture);
+	glBindTexture(target, texture);
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+	int index = targetIndex(target);
+	if (activeUnit >= MAX_UNITS || index < 0) {
+		frame.issued++;
+		glBindTexture(target, texture);
+		return;
+	}
+	if (change(textures[activeUnit][index], texture)) glBindTexture(target, texture);
+}
+
+// deleted names are unbound by GL and may be handed out again, so they must not stay in the copy
+void GLState::deleteTextures(GLsizei count, const GLuint* ids)
+{
+	for (GLsizei i = 0; i < count; i++) {
+		if (ids[i] == 0) continue;
+		for (auto& unit : textures)
+			for (GLuint& texture : unit)
+				if (texture == ids[i]) texture = 0;
+	}
+	glDeleteTextures(count, ids);
+}
+
+void GLState::deleteFramebuffers(GLsizei count, const GLuint* fbos)
+{
+	for (GLsizei i = 0; i < count; i++) {
+		if (fbos[i] == 0) continue;
+		if (drawFbo == fbos[i]) drawFbo = 0;
+		if (readFbo == fbos[i]) readFbo = 0;
+	}
+	glDeleteFramebuffers(count, fbos);
+}
+
+void GLState::enable(GLenum cap)
+{
+	int index = capIndex(cap);
+	if (index < 0) {
+		frame.issued++;
+		glEnable(cap);
+	}
+	else if (change(caps[index], GL_TRUE)) {
+		glEnable(cap);
+	}
+}
+
+void GLState::disable(GLenum cap)
+{
+	int index = capIndex(cap);
+	if (index < 0) {
+		frame.issued++;
+		glDisable(cap);
+	}
+	else if (change(caps[index], GL_FALSE)) {
+		glDisable(cap);
+	}
+}
+
+void GLState::depthMask(GLboolean flag)
+{
+	if (change(depthWrite, flag)) glDepthMask(flag);
+}
+
+// all four channels together, the passes never mask single ones
+void GLState::colorMask(GLboolean mask)
+{
+	if (change(colorWrite, mask)) glColorMask(mask, mask, mask, mask);
+}
+
+void GLState::depthFunc(GLenum func)
+{
+	if (change(depthCompare, func)) glDepthFunc(func);
+}
+
+void GLState::cullFace(GLenum mode)
+{
+	if (change(culledFace, mode)) glCullFace(mode);
+}
+
+void GLState::blendFunc(GLenum src, GLenum dst)
+{
+	if (filtering && blendSrc == src && blendDst == dst) {
+		frame.filtered++;
+		return;
+	}
+	blendSrc = src;
+	blendDst = dst;
+	frame.issued++;
+	glBlendFunc(src, dst);
+}
@@ -0,0 +1,62 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// Shadow copy of the GL state the passes change, so calls that would not change anything never reach the driver.
+// Tracks the program, vertex array, draw and read framebuffers, the textures of every unit and target, the enable
+// caps, depth/color masks, depth function, cull face and blend function. Everything that binds or deletes these goes
+// through here, otherwise the copy goes stale; invalidate() forgets it after code that bypasses it. ImGui's backend
+// saves and restores what it touches, so it needs no invalidate().
+// Stencil state, the viewport and buffer bindings are not tracked.
+class GLState {
+public:
+	struct Counts {
+		unsigned int issued = 0, filtered = 0;
+	};
+	static Counts frame, lastFrame;
+	static bool filtering; // off issues every call, to compare
+
+	static const unsigned int MAX_UNITS = 16;
+
+	static void newFrame();
+	static void invalidate();
+
+	static void useProgram(GLuint program);
+	static void bindVertexArray(GLuint vao);
+	// GL_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER
+	static void bindFramebuffer(GLenum target, GLuint fbo);
+	static void bindFramebuffer(GLuint fbo) { bindFramebuffer(GL_FRAMEBUFFER, fbo); }
+	// on unit, for sampling
+	static void bindTexture(unsigned int unit, GLenum target, GLuint texture);
+	// on the active unit, to create or update the texture
+	static void bindTexture(GLenum target, GLuint texture);
+	static void deleteTextures(GLsizei count, const GLuint* textures);
+	static void deleteFramebuffers(GLsizei count, const GLuint* fbos);
+
+	static void enable(GLenum cap);
+	static void disable(GLenum cap);
+	static void depthMask(GLboolean flag);
+	static void colorMask(GLboolean mask);
+	static void depthFunc(GLenum func);
+	static void cullFace(GLenum mode);
+	static void blendFunc(GLenum src, GLenum dst);
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+	static const unsigned int TARGETS = 5, CAPS = 6;
+
+	static GLuint program, vao, drawFbo, readFbo;
+	static unsigned int activeUnit;
+	static GLuint textures[MAX_UNITS][TARGETS];
+	static GLuint caps[CAPS];
+	static GLuint depthWrite, colorWrite, depthCompare, culledFace, blendSrc, blendDst;
+
+	static int targetIndex(GLenum target);
+	static int capIndex(GLenum cap);
+	static void activeTexture(unsigned int unit);
+	// counts the call, true when it has to reach the driver
+	static bool change(GLuint& cached, GLuint value);
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <glad/glad.h>
+
+// GPU time spent between begin() and end(), measured with GL_TIME_ELAPSED queries. Queries rotate through a small
+// ring and are read back once their result is available, so timing a pass every frame never stalls the CPU.
+// Only one timer can be active at a time, GL does not allow nested elapsed time queries.
+class GpuTimer {
+private:
+	static const unsigned int QUERY_COUNT = 4;
+	unsigned int queries[QUERY_COUNT];
+	bool pending[QUERY_COUNT] = {};
+	unsigned int current = 0;
+
+	void read(unsigned int index) {
+		GLuint64 elapsed;
+		glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &elapsed);
+		lastTime = elapsed / 1000000.0f;
+		pending[index] = false;
+	}
+
+public:
+	// most recent result in milliseconds, a few frames old
+	float lastTime = 0.0f;
+
+	GpuTimer() { glGenQueries(QUERY_COUNT, queries); }
+	~GpuTimer() { glDeleteQueries(QUERY_COUNT, queries); }
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	void begin() {
+		if (pending[current]) read(current);
+		glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+	}
+
+	void end() {
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[current] = true;
+		current = (current + 1) % QUERY_COUNT;
+
+		// collect every finished query, oldest first
+		for (unsigned int i = 0; i < QUERY_COUNT; i++) {
+			unsigned int index = (current + i) % QUERY_COUNT;
+			if (!pending[index]) continue;
+			GLint available = 0;
+			glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) break;
+			read(index);
+		}
+	}
+
+	// waits for the last measurement, for benchmarks only
+	float elapsed() {
+		for (unsigned int i = 0; i < QUERY_COUNT; i++) {
+			unsigned int index = (current + i) % QUERY_COUNT;
+			if (pending[index]) read(index);
+		}
+		return lastTime;
+	}
+};
+#endif
@@ -2,39 +2,67 @@
 
 #include "bloompass.h"
 
-HDRPass::HDRPass(unsigned int width, unsigned int height, std::shared_ptr<DeferredLightingPass> lighting) : RenderPass(width, height)
-{
-	this->lighting = lighting;
+#include <cctype>
 
-	HDRShader = std::make_unique<Shader>("src/shaders/hdr.vert", "src/shaders/hdr.frag");
+HDRPass::HDRPass(unsigned int width, unsigned int height) : RenderPass(width, height), params(PARAMS_BINDING)
+{
+	params.edit().exposure = exposureVal;
 
-	HDRShader->use();
-	HDRShader->setInt("hdrMode", hdrMode);
-	HDRShader->setInt("hdrBuffer", 0);
-	HDRShader->setFloat("exposure", exposureVal);
+	HDRShaders = std::make_unique<ShaderVariants>("src/shaders/hdr.vert", "src/shaders/hdr.frag",
+		std::vector<std::string>{ "BLOOM", "TONEMAP_REINHARD", "TONEMAP_EXPOSURE" }, std::vector<std::string>{}, [this](Shader& shader) {
+			shader.bindUniformBlock("HDRParams", PARAMS_BINDING);
+			for (auto& unit : graphUnits)
+				shader.setInt(unit.first, unit.second);
+		});
+	// the current combination now, the other valid ones in the background. The tone mapping operators never go together.
+	selectVariant();
+	HDRShaders->get(variant);
+	for (unsigned int bloom : { 0u, HDRShaders->bit("BLOOM") })
+		HDRShaders->prewarm({ bloom, bloom | HDRShaders->bit("TONEMAP_REINHARD"), bloom | HDRShaders->bit("TONEMAP_EXPOSURE") });
 }
 
 HDRPass::~HDRPass()
 {
 }
 
-void HDRPass::Render()
+void HDRPass::Setup(RenderGraph::Builder& builder)
 {
-	// render to screen
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, lighting->colorBuffers[0]);
+	builder.sideEffect();
+	graphUnits.clear();
+	graphUnits["hdrBuffer"] = builder.read("hdrColor");
+	for (auto& p : postprocessPasses)
+		for (auto& output_texture : p->output_textures)
+			graphUnits[output_texture.name] = builder.read(output_texture.resource);
+	HDRShaders->forEach([this](Shader& shader) {
+		for (auto& unit : graphUnits)
+			shader.setInt(unit.first, unit.second);
+	});
+	selectVariant();
+}
 
+// BLOOM follows the postprocess outputs, the tone mapping define hdrMode
+void HDRPass::selectVariant()
+{
+	variant = 0;
 	for (auto& p : postprocessPasses) {
 		for (auto& output_texture : p->output_textures) {
-			glActiveTexture(GL_TEXTURE0 + output_texture.texture_unit);
-			glBindTexture(GL_TEXTURE_2D, output_texture.id);
+			std::string feature = output_texture.name;
+			std::transform(feature.begin(), feature.end(), feature.begin(), ::toupper);
+			variant |= HDRShaders->bit(feature);
 		}
 	}
+	if (hdrMode == HDRmode::reinhard) variant |= HDRShaders->bit("TONEMAP_REINHARD");
+	else if (hdrMode == HDRmode::exposure) variant |= HDRShaders->bit("TONEMAP_EXPOSURE");
+}
+
+void HDRPass::Render()
+{
+	// render to screen
+	GLState::bindFramebuffer(0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	HDRShader->use();
+	params.update();
+	HDRShaders->select(variant).use();
 	RenderQuad();
 }
 
@@ -43,33 +71,26 @@ void HDRPass::ResizeBuffers(unsigned int width, unsigned int height)
 	TARGET_WIDTH = width; TARGET_HEIGHT = height;
 }
 
+// the outputs are read and their variant selected in Setup(), which the graph runs again before the next frame
 void HDRPass::AddPostprocessPass(std::shared_ptr<PostprocessPass> postprocessPass)
 {
 	postprocessPasses.push_back(postprocessPass);
-	HDRShader->use();
-	for (auto& output_texture : postprocessPass->output_textures) {
-		HDRShader->setInt(output_texture.name, output_texture.texture_unit);
-		HDRShader->setBool(output_texture.name + "On", true);
-	}
+	graph->addPass(postprocessPass->name, postprocessPass);
 }
 
 void HDRPass::RemovePostprocessPass(std::shared_ptr<PostprocessPass> postprocessPass)
 {
-	HDRShader->use();
-	for (auto& output_texture : postprocessPass->output_textures)
-		HDRShader->setBool(output_texture.name + "On", false);
-
 	postprocessPasses.erase(std::remove(postprocessPasses.begin(), postprocessPasses.end(), postprocessPass));
+	selectVariant();
+	graph->removePass(postprocessPass);
 }
 
 void HDRPass::updateHDRMode()
 {
-	HDRShader->use();
-	HDRShader->setInt("hdrMode", hdrMode);
+	selectVariant();
 }
 
 void HDRPass::updateExposure()
 {
-	HDRShader->use();
-	HDRShader->setFloat("exposure", exposureVal);
+	params.edit().exposure = exposureVal;
 }
@@ -2,19 +2,35 @@
 #define HDRPASS_H
 
 #include "renderpass.h"
-#include "deferredlighting.h"
 #include "postprocesspass.h"
+#include "shadervariants.h"
+#include "uniformbuffer.h"
 
 #include <map>
 
 class BloomPass;
+
+// std140 layout of the HDRParams uniform block
+struct HDRBlock {
+	float exposure;
+	float pad[3];
+};
+
+// tone maps "hdrColor" to the screen, the last pass of the render graph
 class HDRPass : public RenderPass
 {
 private:
-	std::unique_ptr<Shader> HDRShader;
-	std::shared_ptr<DeferredLightingPass> lighting;
+	// variants: BLOOM when the bloom pass runs, TONEMAP_REINHARD or TONEMAP_EXPOSURE from hdrMode
+	std::unique_ptr<ShaderVariants> HDRShaders;
+	unsigned int variant = 0;
+	std::map<std::string, int> graphUnits; // sampler units of the render graph's textures, set on every variant
+	UniformBuffer<HDRBlock> params;
+
+	void selectVariant();
 
 public:
+	static const unsigned int PARAMS_BINDING = 5;
+
 	enum HDRmode {
 		off,
 		reinhard,
@@ -26,11 +42,13 @@ public:
 
 	std::vector<std::shared_ptr<PostprocessPass>> postprocessPasses;
 
-	HDRPass(unsigned int width, unsigned int height, std::shared_ptr<DeferredLightingPass> lighting);
+	HDRPass(unsigned int width, unsigned int height);
 	~HDRPass();
+	void Setup(RenderGraph::Builder& builder) override;
 	void Render() override;
 	void ResizeBuffers(unsigned int width, unsigned int height) override;
 
+	// also adds the pass to the render graph, or removes it
 	void AddPostprocessPass(std::shared_ptr<PostprocessPass> postprocessPass);
 	void RemovePostprocessPass(std::shared_ptr<PostprocessPass> postprocessPass);
 
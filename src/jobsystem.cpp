@@ -0,0 +1,161 @@
+#include "jobsystem.h"
+
+namespace {
+	thread_local const JobSystem* currentSystem = nullptr;
+	thread_local unsigned int currentIndex = 0;
+}
+
+JobSystem::JobSystem(unsigned int threadCount)
+{
+	threadCount = (threadCount > 0) ? threadCount : 1;
+	for (unsigned int i = 0; i < threadCount; i++)
+		queues.push_back(std::make_unique<Queue>());
+
+	// queue 0 is served by the owning thread
+	for (unsigned int i = 1; i < threadCount; i++)
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	wake.notify_all();
+	for (auto& worker : workers) worker.join();
+}
+
+void JobSystem::run(Job job, Counter* counter)
+{
+	if (counter) counter->pending++;
+	push({ std::move(job), counter });
+}
+
+void JobSystem::runAfter(Counter& dependency, Job job, Counter* counter)
+{
+	if (counter) counter->pending++;
+	{
+		std::lock_guard<std::mutex> lock(dependency.mutex);
+		if (!dependency.done()) {
+			dependency.continuations.emplace_back(std::move(job), counter);
+			return;
+		}
+	}
+	push({ std::move(job), counter });
+}
+
+void JobSystem::wait(Counter& counter)
+{
+	// help out instead of blocking, so waiting from inside a job can't deadlock
+	while (!counter.done()) {
+		Entry entry;
+		if (pop(entry))
+			execute(entry);
+		else
+			std::this_thread::yield();
+	}
+	// the last job may still be holding the counter's lock, don't let the caller destroy it before it's released
+	std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int grain, const std::function<void(unsigned int, unsigned int)>& fn)
+{
+	if (count == 0) return;
+	grain = (grain > 0) ? grain : 1;
+	if (count <= grain || threadCount() == 1) {
+		fn(0, count);
+		return;
+	}
+
+	Counter counter;
+	for (unsigned int begin = 0; begin < count; begin += grain) {
+		unsigned int end = (begin + grain < count) ? begin + grain : count;
+		run([&fn, begin, end]() { fn(begin, end); }, &counter);
+	}
+	wait(counter);
+}
+
+unsigned int JobSystem::queueIndex() const
+{
+	return (currentSystem == this) ? currentIndex : 0;
+}
+
+void JobSystem::push(Entry entry)
+{
+	Queue& queue = *queues[queueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(entry));
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queued++;
+	}
+	wake.notify_one();
+}
+
+bool JobSystem::pop(Entry& entry)
+{
+	unsigned int own = queueIndex();
+	{
+		Queue& queue = *queues[own];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			entry = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	// steal the oldest job of another queue, those tend to be the largest pieces of work
+	for (unsigned int i = 1; i < queues.size(); i++) {
+		Queue& victim = *queues[(own + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			entry = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(Entry& entry)
+{
+	entry.job();
+	finish(entry.counter);
+}
+
+void JobSystem::finish(Counter* counter)
+{
+	if (!counter) return;
+
+	std::vector<std::pair<Job, Counter*>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		if (--counter->pending > 0) return;
+		continuations.swap(counter->continuations);
+	}
+	for (auto& continuation : continuations)
+		push({ std::move(continuation.first), continuation.second });
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+	currentSystem = this;
+	currentIndex = index;
+
+	while (running) {
+		Entry entry;
+		if (pop(entry)) {
+			execute(entry);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this]() { return queued > 0 || !running; });
+	}
+}
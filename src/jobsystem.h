@@ -0,0 +1,64 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job system. Each worker owns a queue which it pushes to and pops from at the back,
+// idle workers steal from the front of other queues. Queue 0 belongs to the thread that owns the system
+// (the GL context thread), which also executes jobs while it waits on a counter.
+class JobSystem {
+public:
+	typedef std::function<void()> Job;
+
+	// Number of jobs in flight for a group. Jobs scheduled with runAfter() are queued once it reaches zero.
+	class Counter {
+		friend class JobSystem;
+		std::atomic<int> pending{ 0 };
+		std::mutex mutex;
+		std::vector<std::pair<Job, Counter*>> continuations;
+	public:
+		bool done() const { return pending.load() == 0; }
+	};
+
+	JobSystem(unsigned int threadCount = std::thread::hardware_concurrency());
+	~JobSystem();
+
+	unsigned int threadCount() const { return (unsigned int)queues.size(); }
+
+	void run(Job job, Counter* counter = nullptr);
+	void runAfter(Counter& dependency, Job job, Counter* counter = nullptr);
+	void wait(Counter& counter);
+	void parallelFor(unsigned int count, unsigned int grain, const std::function<void(unsigned int, unsigned int)>& fn);
+
+private:
+	struct Entry {
+		Job job;
+		Counter* counter;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Entry> jobs;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::atomic<bool> running{ true };
+	std::atomic<int> queued{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+
+	unsigned int queueIndex() const;
+	void push(Entry entry);
+	bool pop(Entry& entry);
+	void execute(Entry& entry);
+	void finish(Counter* counter);
+	void workerLoop(unsigned int index);
+};
+#endif
@@ -3,71 +3,103 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <imgui/imgui.h>
 
+#include <string>
+
+// Range used for lights without attenuation, which would otherwise reach infinitely far
+const float LIGHT_RANGE_MAX = 1000.0f;
+
+// Distance at which the attenuated brightest colour channel drops below 5/256
+inline float lightRange(const glm::vec4& color, float Linear, float Quadratic) {
+	float c = (256.0f / 5.0f) * glm::max(color.r, glm::max(color.g, color.b)) - 1.0f;
+	if (c <= 0.0f) return 0.0f;
+	float range;
+	if (Quadratic > 0.0f)
+		range = (-Linear + glm::sqrt(Linear * Linear + 4.0f * Quadratic * c)) / (2.0f * Quadratic);
+	else if (Linear > 0.0f)
+		range = c / Linear;
+	else
+		range = LIGHT_RANGE_MAX;
+	return glm::min(range, LIGHT_RANGE_MAX);
+}
+
+// The light structs are uploaded as they are, so they follow std140 rules and mirror the GLSL declarations.
+// range caches radius() for the shaders and is refreshed by the LightManager on upload.
+// renderUI() edits the light in place and returns whether it changed.
+
 struct PointLight {
 	glm::vec4 pos, color;
-	float Linear, Quadratic, pad1, pad2;
-
-	void renderUI(int index) {
-		if (ImGui::TreeNode(("Point light " + std::to_string(index)).c_str())) {
-			ImGui::DragFloat3("Position", glm::value_ptr(pos));
-			ImGui::ColorEdit3("Colour", glm::value_ptr(color));
-			ImGui::Text("Attenuation");
-			ImGui::DragFloat("##Linear", &Linear, 0.01, 0.0, 0.0, "Linear: %.2f");
-			ImGui::DragFloat("##Quadratic", &Quadratic, 0.01, 0.0, 0.0, "Quadratic: %.2f");
-			ImGui::TreePop();
-		}
+	float Linear, Quadratic, range;
+	float shadowSlot = -1.0f; // set by the PointShadowPass, -1 without shadow
+
+	float radius() const { return lightRange(color, Linear, Quadratic); }
+
+	bool renderUI() {
+		bool changed = false;
+		changed |= ImGui::DragFloat3("Position", glm::value_ptr(pos));
+		changed |= ImGui::ColorEdit3("Colour", glm::value_ptr(color));
+		ImGui::Text("Attenuation");
+		changed |= ImGui::DragFloat("##Linear", &Linear, 0.01, 0.0, 0.0, "Linear: %.2f");
+		changed |= ImGui::DragFloat("##Quadratic", &Quadratic, 0.01, 0.0, 0.0, "Quadratic: %.2f");
+		return changed;
 	}
 };
 
 struct DirLight {
 	glm::vec4 dir, color;
-	void renderUI(int index) {
-		if (ImGui::TreeNode(("Directional light " + std::to_string(index)).c_str())) {
-			if (ImGui::DragFloat3("Direction", glm::value_ptr(dir), 0.001f)) {
-				if (glm::vec3(dir) == glm::zero<glm::vec3>())
-					dir = glm::vec4(1.0f, 0.0f, 0.0f, 0.0);
-				else
-					dir = glm::normalize(dir);
-			}
-			ImGui::ColorEdit3("Colour", glm::value_ptr(color));
-			ImGui::TreePop();
+
+	bool renderUI() {
+		bool changed = false;
+		if (ImGui::DragFloat3("Direction", glm::value_ptr(dir), 0.001f)) {
+			if (glm::vec3(dir) == glm::zero<glm::vec3>())
+				dir = glm::vec4(1.0f, 0.0f, 0.0f, 0.0);
+			else
+				dir = glm::normalize(dir);
+			changed = true;
 		}
+		changed |= ImGui::ColorEdit3("Colour", glm::value_ptr(color));
+		return changed;
 	}
 };
 
 struct SpotLight {
 	glm::vec4 pos, dir, color;
 	float cutOff, outerCutOff, Linear, Quadratic;
+	float range, pad1, pad2, pad3;
+
+	float radius() const { return lightRange(color, Linear, Quadratic); }
 
-	void renderUI(int index) {
-		if (ImGui::TreeNode(("Spot light " + std::to_string(index)).c_str())) {
-			ImGui::DragFloat3("Position", glm::value_ptr(pos));
-			if (ImGui::DragFloat3("Direction", glm::value_ptr(dir), 0.001f)) {
-				if (glm::vec3(dir) == glm::zero<glm::vec3>())
-					dir = glm::vec4(1.0f, 0.0f, 0.0f, 0.0);
-				else
-					dir = glm::normalize(dir);
-			}
-			ImGui::ColorEdit3("Colour", glm::value_ptr(color));
-			ImGui::Text("Light cone");
-
-			float cutOffDeg = glm::degrees(glm::acos(cutOff));
-			float outerCutOffDeg = glm::degrees(glm::acos(outerCutOff));
-			if (ImGui::DragFloat("Cutoff", &cutOffDeg, 0.1, 0.0, 90.0f, "%.2f deg")) {
-				cutOff = glm::cos(glm::radians(cutOffDeg));
-			}
-			if (ImGui::DragFloat("Outer cutoff", &outerCutOffDeg, 0.1, 0.0, 90.0f, "%.2f deg")) {
-				outerCutOffDeg = glm::clamp(outerCutOffDeg, cutOffDeg, 90.0f);
-				outerCutOff = glm::cos(glm::radians(outerCutOffDeg));
-			}
-			ImGui::Text("Attenuation");
-			ImGui::DragFloat("##Linear", &Linear, 0.01, 0.0, 0.0, "Linear: %.2f");
-			ImGui::DragFloat("##Quadratic", &Quadratic, 0.01, 0.0, 0.0, "Quadratic: %.2f");
-			ImGui::TreePop();
+	bool renderUI() {
+		bool changed = false;
+		changed |= ImGui::DragFloat3("Position", glm::value_ptr(pos));
+		if (ImGui::DragFloat3("Direction", glm::value_ptr(dir), 0.001f)) {
+			if (glm::vec3(dir) == glm::zero<glm::vec3>())
+				dir = glm::vec4(1.0f, 0.0f, 0.0f, 0.0);
+			else
+				dir = glm::normalize(dir);
+			changed = true;
+		}
+		changed |= ImGui::ColorEdit3("Colour", glm::value_ptr(color));
+		ImGui::Text("Light cone");
+
+		float cutOffDeg = glm::degrees(glm::acos(cutOff));
+		float outerCutOffDeg = glm::degrees(glm::acos(outerCutOff));
+		if (ImGui::DragFloat("Cutoff", &cutOffDeg, 0.1, 0.0, 90.0f, "%.2f deg")) {
+			cutOff = glm::cos(glm::radians(cutOffDeg));
+			changed = true;
+		}
+		if (ImGui::DragFloat("Outer cutoff", &outerCutOffDeg, 0.1, 0.0, 90.0f, "%.2f deg")) {
+			outerCutOffDeg = glm::clamp(outerCutOffDeg, cutOffDeg, 90.0f);
+			outerCutOff = glm::cos(glm::radians(outerCutOffDeg));
+			changed = true;
 		}
+		ImGui::Text("Attenuation");
+		changed |= ImGui::DragFloat("##Linear", &Linear, 0.01, 0.0, 0.0, "Linear: %.2f");
+		changed |= ImGui::DragFloat("##Quadratic", &Quadratic, 0.01, 0.0, 0.0, "Quadratic: %.2f");
+		return changed;
 	}
 };
 
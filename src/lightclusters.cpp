@@ -0,0 +1,227 @@
+#include "lightclusters.h"
+#include "glstate.h"
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLUSTER_SIMD
+#include <emmintrin.h>
+#endif
+
+namespace {
+	void createTextureBuffer(unsigned int& buffer, unsigned int& texture, GLenum format)
+	{
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glGenTextures(1, &texture);
+		GLState::bindTexture(GL_TEXTURE_BUFFER, texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+	}
+
+	// orphans the old storage so the upload doesn't wait on draws still reading it
+	template<typename T>
+	void upload(unsigned int buffer, const std::vector<T>& data)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		glBufferData(GL_TEXTURE_BUFFER, glm::max(sizeof(T) * data.size(), (size_t)16), NULL, GL_STREAM_DRAW);
+		if (!data.empty()) glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(T) * data.size(), data.data());
+	}
+}
+
+LightClusters::LightClusters()
+{
+	createTextureBuffer(clusterBuffer, clusterTexture, GL_RG32UI);
+	createTextureBuffer(indexBuffer, indexTexture, GL_R32UI);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	sliceIndices.resize(GRID_Z);
+	clusters.resize(CLUSTER_COUNT);
+}
+
+LightClusters::~LightClusters()
+{
+	unsigned int textures[2] = { clusterTexture, indexTexture };
+	unsigned int buffers[2] = { clusterBuffer, indexBuffer };
+	GLState::deleteTextures(2, textures);
+	glDeleteBuffers(2, buffers);
+}
+
+void LightClusters::buildClusterBounds(const Camera& camera)
+{
+	boundsZoom = camera.Zoom; boundsAspect = camera.Aspect; boundsNear = camera.ZNear; boundsFar = camera.ZFar;
+
+	float tanY = glm::tan(glm::radians(camera.Zoom) * 0.5f);
+	float tanX = tanY * camera.Aspect;
+	float ratio = camera.ZFar / camera.ZNear;
+	sliceScale = GRID_Z / std::log(ratio);
+	sliceBias = -(float)GRID_Z * std::log(camera.ZNear) / std::log(ratio);
+
+	clusterBounds.resize(CLUSTER_COUNT);
+	for (unsigned int z = 0; z < GRID_Z; z++) {
+		float zNear = camera.ZNear * std::pow(ratio, z / (float)GRID_Z);
+		float zFar = camera.ZNear * std::pow(ratio, (z + 1) / (float)GRID_Z);
+		for (unsigned int y = 0; y < GRID_Y; y++) {
+			for (unsigned int x = 0; x < GRID_X; x++) {
+				// the tile's corners on the slice's near and far planes
+				glm::vec2 ndcMin(-1.0f + 2.0f * x / GRID_X, -1.0f + 2.0f * y / GRID_Y);
+				glm::vec2 ndcMax(-1.0f + 2.0f * (x + 1) / GRID_X, -1.0f + 2.0f * (y + 1) / GRID_Y);
+				Bounds bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+				for (float depth : { zNear, zFar }) {
+					for (glm::vec2 ndc : { ndcMin, ndcMax }) {
+						glm::vec3 p(ndc.x * tanX * depth, ndc.y * tanY * depth, -depth);
+						bounds.min = glm::min(bounds.min, p);
+						bounds.max = glm::max(bounds.max, p);
+					}
+				}
+				clusterBounds[(z * GRID_Y + y) * GRID_X + x] = bounds;
+			}
+		}
+	}
+}
+
+void LightClusters::build(const Camera& camera, const LightManager& lights, JobSystem& jobs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (camera.Zoom != boundsZoom || camera.Aspect != boundsAspect || camera.ZNear != boundsNear || camera.ZFar != boundsFar)
+		buildClusterBounds(camera);
+
+	// view space bounding spheres, point lights first. The ranges were refreshed by LightManager::upload().
+	const glm::mat4& view = camera.matrices.view;
+	lightCount = (unsigned int)(lights.pointLights.size() + lights.spotLights.size());
+	unsigned int padded = (lightCount + 3) & ~3u;
+	sphereX.resize(padded); sphereY.resize(padded); sphereZ.resize(padded);
+	sphereRadius.assign(padded, -1.0f); // padding never passes the tests
+	lightIds.resize(lightCount);
+
+	unsigned int i = 0;
+	for (const auto& light : lights.pointLights) {
+		glm::vec3 pos = glm::vec3(view * glm::vec4(glm::vec3(light.pos), 1.0f));
+		sphereX[i] = pos.x; sphereY[i] = pos.y; sphereZ[i] = pos.z; sphereRadius[i] = light.range;
+		lightIds[i] = i;
+		i++;
+	}
+	for (const auto& light : lights.spotLights) {
+		glm::vec3 pos = glm::vec3(view * glm::vec4(glm::vec3(light.pos), 1.0f));
+		glm::vec3 dir = glm::normalize(glm::vec3(view * glm::vec4(glm::vec3(light.dir), 0.0f)));
+		float range = light.range;
+
+		// smallest sphere around the cone
+		float cosAngle = glm::clamp(light.outerCutOff, 0.0f, 1.0f);
+		glm::vec3 center;
+		float radius;
+		if (cosAngle >= 0.70710678f) {
+			radius = range / (2.0f * cosAngle * cosAngle);
+			center = pos + dir * radius;
+		}
+		else {
+			radius = range * glm::sqrt(1.0f - cosAngle * cosAngle);
+			center = pos + dir * range * cosAngle;
+		}
+		sphereX[i] = center.x; sphereY[i] = center.y; sphereZ[i] = center.z; sphereRadius[i] = radius;
+		lightIds[i] = (i - (unsigned int)lights.pointLights.size()) | SPOT_LIGHT_BIT;
+		i++;
+	}
+
+	// slices are independent, each one writes its own index list
+	jobs.parallelFor(GRID_Z, 1, [this](unsigned int begin, unsigned int end) {
+		for (unsigned int z = begin; z < end; z++) assignSlice(z);
+	});
+
+	// cluster offsets are relative to the start of their slice, rebase them while concatenating
+	indices.clear();
+	maxLightsPerCluster = 0;
+	for (unsigned int z = 0; z < GRID_Z; z++) {
+		unsigned int base = (unsigned int)indices.size();
+		for (unsigned int c = z * GRID_X * GRID_Y; c < (z + 1) * GRID_X * GRID_Y; c++) {
+			clusters[c].x += base;
+			maxLightsPerCluster = glm::max(maxLightsPerCluster, clusters[c].y);
+		}
+		indices.insert(indices.end(), sliceIndices[z].begin(), sliceIndices[z].end());
+	}
+	averageLightsPerCluster = indices.size() / (float)CLUSTER_COUNT;
+
+	upload(clusterBuffer, clusters);
+	upload(indexBuffer, indices);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	lastAssignTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Tests the lights against the depth range of the slice first, then the survivors against every cluster of the slice
+void LightClusters::assignSlice(unsigned int z)
+{
+	std::vector<unsigned int>& out = sliceIndices[z];
+	out.clear();
+
+	const Bounds* bounds = &clusterBounds[z * GRID_X * GRID_Y];
+	float sliceNear = -bounds[0].max.z, sliceFar = -bounds[0].min.z;
+
+	std::vector<unsigned int> candidates;
+#ifdef CLUSTER_SIMD
+	__m128 nearPlane = _mm_set1_ps(sliceNear), farPlane = _mm_set1_ps(sliceFar);
+	for (unsigned int i = 0; i < sphereZ.size(); i += 4) {
+		__m128 depth = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&sphereZ[i]));
+		__m128 radius = _mm_loadu_ps(&sphereRadius[i]);
+		__m128 inside = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(depth, radius), nearPlane), _mm_cmple_ps(_mm_sub_ps(depth, radius), farPlane));
+		int mask = _mm_movemask_ps(_mm_and_ps(inside, _mm_cmpge_ps(radius, _mm_setzero_ps())));
+		for (unsigned int j = 0; mask; j++, mask >>= 1)
+			if (mask & 1) candidates.push_back(i + j);
+	}
+#else
+	for (unsigned int i = 0; i < lightCount; i++) {
+		float depth = -sphereZ[i];
+		if (depth + sphereRadius[i] >= sliceNear && depth - sphereRadius[i] <= sliceFar)
+			candidates.push_back(i);
+	}
+#endif
+
+	// gather the candidates' spheres so four can be tested against a cluster at once
+	unsigned int count = (unsigned int)candidates.size();
+	unsigned int padded = (count + 3) & ~3u;
+	std::vector<float> cx(padded, 0.0f), cy(padded, 0.0f), cz(padded, 0.0f), r2(padded, -1.0f);
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int light = candidates[i];
+		cx[i] = sphereX[light]; cy[i] = sphereY[light]; cz[i] = sphereZ[light];
+		r2[i] = sphereRadius[light] * sphereRadius[light];
+	}
+
+	for (unsigned int tile = 0; tile < GRID_X * GRID_Y; tile++) {
+		const Bounds& b = bounds[tile];
+		glm::uvec2& cluster = clusters[z * GRID_X * GRID_Y + tile];
+		cluster = glm::uvec2((unsigned int)out.size(), 0);
+
+#ifdef CLUSTER_SIMD
+		// squared distance from the sphere centre to the box
+		__m128 minX = _mm_set1_ps(b.min.x), minY = _mm_set1_ps(b.min.y), minZ = _mm_set1_ps(b.min.z);
+		__m128 maxX = _mm_set1_ps(b.max.x), maxY = _mm_set1_ps(b.max.y), maxZ = _mm_set1_ps(b.max.z);
+		__m128 zero = _mm_setzero_ps();
+		for (unsigned int i = 0; i < padded; i += 4) {
+			__m128 x = _mm_loadu_ps(&cx[i]), y = _mm_loadu_ps(&cy[i]), zc = _mm_loadu_ps(&cz[i]);
+			__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minX, x), zero), _mm_max_ps(_mm_sub_ps(x, maxX), zero));
+			__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minY, y), zero), _mm_max_ps(_mm_sub_ps(y, maxY), zero));
+			__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minZ, zc), zero), _mm_max_ps(_mm_sub_ps(zc, maxZ), zero));
+			__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			int mask = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_loadu_ps(&r2[i])));
+			for (unsigned int j = 0; mask; j++, mask >>= 1)
+				if (mask & 1) out.push_back(lightIds[candidates[i + j]]);
+		}
+#else
+		for (unsigned int i = 0; i < count; i++) {
+			glm::vec3 c(cx[i], cy[i], cz[i]);
+			glm::vec3 d = glm::max(b.min - c, 0.0f) + glm::max(c - b.max, 0.0f);
+			if (glm::dot(d, d) <= r2[i]) out.push_back(lightIds[candidates[i]]);
+		}
+#endif
+		cluster.y = (unsigned int)out.size() - cluster.x;
+	}
+}
+
+void LightClusters::bindTextures() const
+{
+	GLState::bindTexture(CLUSTER_UNIT, GL_TEXTURE_BUFFER, clusterTexture);
+	GLState::bindTexture(LIGHT_INDEX_UNIT, GL_TEXTURE_BUFFER, indexTexture);
+}
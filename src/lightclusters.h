@@ -0,0 +1,67 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "camera.h"
+#include "jobsystem.h"
+#include "lightmanager.h"
+
+// Clustered light assignment. The view frustum is split into a grid of froxels (screen tiles x exponential depth
+// slices) and every point and spot light is assigned on the CPU to the froxels its bounding sphere touches.
+// The lighting shader finds the froxel of a pixel and only shades the lights listed for it.
+// The per-cluster (offset, count) pairs and the light index list are read through texture buffers, the light data
+// itself comes from the LightManager's buffers. Spot light indices are tagged with SPOT_LIGHT_BIT.
+class LightClusters {
+public:
+	// passed to glighting.frag as the CLUSTER_* defines
+	static const unsigned int GRID_X = 16, GRID_Y = 9, GRID_Z = 24;
+	static const unsigned int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+	// texture units of the buffers, above the ones handed out to preprocess passes
+	static const unsigned int CLUSTER_UNIT = 14, LIGHT_INDEX_UNIT = 15;
+	static const unsigned int SPOT_LIGHT_BIT = 0x80000000u;
+
+	// slice = log(-z) * sliceScale + sliceBias
+	float sliceScale = 0.0f;
+	float sliceBias = 0.0f;
+
+	// stats of the last build()
+	float lastAssignTime = 0.0f;
+	float averageLightsPerCluster = 0.0f;
+	unsigned int maxLightsPerCluster = 0;
+	unsigned int lightCount = 0;
+
+	LightClusters();
+	~LightClusters();
+
+	void build(const Camera& camera, const LightManager& lights, JobSystem& jobs);
+	void bindTextures() const;
+
+private:
+	struct Bounds {
+		glm::vec3 min, max;
+	};
+
+	unsigned int clusterBuffer, clusterTexture; // RG32UI, (offset, count) per cluster
+	unsigned int indexBuffer, indexTexture;     // R32UI
+
+	// view space cluster bounds, rebuilt when the projection changes
+	std::vector<Bounds> clusterBounds;
+	float boundsZoom = 0.0f, boundsAspect = 0.0f, boundsNear = 0.0f, boundsFar = 0.0f;
+	void buildClusterBounds(const Camera& camera);
+
+	// view space bounding spheres, SoA and padded to a multiple of 4 for the SIMD tests
+	std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+	std::vector<unsigned int> lightIds;
+
+	std::vector<std::vector<unsigned int>> sliceIndices;
+	std::vector<glm::uvec2> clusters;
+	std::vector<unsigned int> indices;
+
+	void assignSlice(unsigned int z);
+};
+#endif
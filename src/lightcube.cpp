@@ -20,7 +20,7 @@ LightCubePass::~LightCubePass()
 void LightCubePass::Render()
 {
 	lightCubeShader->use();
-	for (unsigned int i = 0; i < (int)(sizeof(SceneLights::pointLights) / sizeof(PointLight)); i++) {
+	for (unsigned int i = 0; i < scene->lights.pointLights.size(); i++) {
 		lightCubeShader->setInt("lightIndex", i);
 		RenderCube();
 	}
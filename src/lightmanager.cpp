@@ -0,0 +1,128 @@
+#include "lightmanager.h"
+#include "constantring.h"
+#include "glstate.h"
+
+#include <cstddef>
+#include <string>
+
+#include <imgui/imgui.h>
+
+namespace {
+	// One selectable line per light and only the visible lines are submitted, so the list stays cheap with
+	// thousands of lights. The selected light is edited below the list.
+	template<typename T>
+	void renderPoolUI(LightPool<T>& pool, const char* label, LightHandle& selected, const T& defaultLight, size_t maxLights)
+	{
+		ImGui::PushID(label);
+		if (ImGui::Button("Add") && pool.size() < maxLights) selected = pool.add(defaultLight);
+		ImGui::SameLine();
+		if (ImGui::Button("Remove")) pool.remove(selected);
+		ImGui::SameLine();
+		ImGui::Text("%zu lights", pool.size());
+
+		ImGui::BeginChild("list", ImVec2(0.0f, 6 * ImGui::GetTextLineHeightWithSpacing()), true);
+		ImGuiListClipper clipper;
+		clipper.Begin((int)pool.size());
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+				LightHandle handle = pool.handle(i);
+				if (ImGui::Selectable((std::string(label) + " " + std::to_string(handle.index)).c_str(), handle == selected))
+					selected = handle;
+			}
+		}
+		ImGui::EndChild();
+
+		if (pool.alive(selected) && pool.get(selected).renderUI())
+			pool.markDirty(selected);
+		ImGui::PopID();
+	}
+}
+
+LightManager::~LightManager()
+{
+	if (pointBuffer.buffer == 0) return;
+	unsigned int textures[2] = { pointBuffer.texture, spotBuffer.texture };
+	unsigned int buffers[2] = { pointBuffer.buffer, spotBuffer.buffer };
+	GLState::deleteTextures(2, textures);
+	glDeleteBuffers(2, buffers);
+}
+
+template<typename T>
+void LightManager::upload(LightPool<T>& pool, LightBuffer& buffer)
+{
+	if (buffer.buffer == 0) {
+		glGenBuffers(1, &buffer.buffer);
+		glGenTextures(1, &buffer.texture);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer.buffer);
+
+	// out of room: double the capacity and send everything again
+	if (buffer.capacity == 0 || pool.size() > buffer.capacity) {
+		buffer.capacity = std::max(buffer.capacity * 2, std::max(pool.size(), (size_t)64));
+		glBufferData(GL_TEXTURE_BUFFER, buffer.capacity * sizeof(T), NULL, GL_DYNAMIC_DRAW);
+		GLState::bindTexture(GL_TEXTURE_BUFFER, buffer.texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer.buffer);
+		pool.markAllDirty();
+	}
+
+	if (pool.dirty()) {
+		unsigned int begin = pool.dirtyBegin, end = std::min(pool.dirtyEnd, (unsigned int)pool.size());
+		for (unsigned int i = begin; i < end; i++)
+			pool.data()[i].range = pool[i].radius();
+		glBufferSubData(GL_TEXTURE_BUFFER, begin * sizeof(T), (end - begin) * sizeof(T), pool.data() + begin);
+		lastUploadBytes += (end - begin) * sizeof(T);
+	}
+	pool.clearDirty();
+}
+
+void LightManager::upload()
+{
+	lastUploadBytes = 0;
+	upload(pointLights, pointBuffer);
+	upload(spotLights, spotBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// the Lights block is small and lives in the constant ring, so it is written whole every frame
+	GLintptr offset;
+	DirLightBlock* block = (DirLightBlock*)ConstantRing::allocate(sizeof(DirLightBlock), offset);
+	int count = (int)std::min(dirLights.size(), (size_t)MAX_DIR_LIGHTS);
+	std::copy(dirLights.data(), dirLights.data() + count, block->dirLights);
+	block->dirLightCount = count;
+	ConstantRing::bind(1, offset, sizeof(DirLightBlock));
+	dirLights.clearDirty();
+}
+
+void LightManager::bindTextures() const
+{
+	GLState::bindTexture(POINT_LIGHT_UNIT, GL_TEXTURE_BUFFER, pointBuffer.texture);
+	GLState::bindTexture(SPOT_LIGHT_UNIT, GL_TEXTURE_BUFFER, spotBuffer.texture);
+}
+
+void LightManager::renderUI()
+{
+	PointLight point = {};
+	point.pos = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+	point.color = glm::vec4(1.0f);
+	point.Linear = 0.35f;
+	point.Quadratic = 0.44f;
+
+	SpotLight spot = {};
+	spot.pos = glm::vec4(0.0f, 3.0f, 0.0f, 1.0f);
+	spot.dir = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f);
+	spot.color = glm::vec4(1.0f);
+	spot.cutOff = glm::cos(glm::radians(20.0f));
+	spot.outerCutOff = glm::cos(glm::radians(30.0f));
+	spot.Linear = 0.35f;
+	spot.Quadratic = 0.44f;
+
+	DirLight dir = {};
+	dir.dir = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f);
+	dir.color = glm::vec4(0.5f);
+
+	ImGui::SeparatorText("Point lights");
+	renderPoolUI(pointLights, "Point light", selectedPoint, point, SIZE_MAX);
+	ImGui::SeparatorText("Directional lights");
+	renderPoolUI(dirLights, "Directional light", selectedDir, dir, MAX_DIR_LIGHTS);
+	ImGui::SeparatorText("Spot lights");
+	renderPoolUI(spotLights, "Spot light", selectedSpot, spot, SIZE_MAX);
+}
@@ -0,0 +1,145 @@
+#ifndef LIGHTMANAGER_H
+#define LIGHTMANAGER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "light.h"
+
+#define MAX_DIR_LIGHTS 4
+
+struct LightHandle {
+	unsigned int index = UINT_MAX;
+	unsigned int generation = 0;
+
+	bool operator==(const LightHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const LightHandle& other) const { return !(*this == other); }
+};
+
+// Packed storage for one kind of light. The lights stay contiguous so the array can be uploaded as it is,
+// handles resolve through a slot table and removal moves the last light into the hole.
+// Every change widens a single dirty index range, which is all that gets uploaded.
+template<typename T>
+class LightPool {
+private:
+	struct Slot {
+		unsigned int generation;
+		unsigned int dense;
+	};
+	std::vector<T> lights;
+	std::vector<unsigned int> denseToSlot;
+	std::vector<Slot> slots;
+	std::vector<unsigned int> freeSlots;
+
+public:
+	unsigned int dirtyBegin = UINT_MAX, dirtyEnd = 0;
+
+	LightHandle add(const T& light) {
+		LightHandle handle;
+		if (!freeSlots.empty()) {
+			handle.index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			handle.index = (unsigned int)slots.size();
+			slots.push_back({ 0, 0 });
+		}
+		handle.generation = slots[handle.index].generation;
+		slots[handle.index].dense = (unsigned int)lights.size();
+		denseToSlot.push_back(handle.index);
+		lights.push_back(light);
+		markDirty((unsigned int)lights.size() - 1);
+		return handle;
+	}
+
+	void remove(LightHandle handle) {
+		if (!alive(handle)) return;
+		unsigned int dense = slots[handle.index].dense, last = (unsigned int)lights.size() - 1;
+		if (dense != last) {
+			lights[dense] = lights[last];
+			denseToSlot[dense] = denseToSlot[last];
+			slots[denseToSlot[dense]].dense = dense;
+			markDirty(dense);
+		}
+		lights.pop_back();
+		denseToSlot.pop_back();
+		slots[handle.index].generation++;
+		freeSlots.push_back(handle.index);
+	}
+
+	void clear() {
+		for (unsigned int slot : denseToSlot) {
+			slots[slot].generation++;
+			freeSlots.push_back(slot);
+		}
+		lights.clear();
+		denseToSlot.clear();
+	}
+
+	bool alive(LightHandle handle) const { return handle.index < slots.size() && slots[handle.index].generation == handle.generation; }
+	LightHandle handle(unsigned int dense) const { return { denseToSlot[dense], slots[denseToSlot[dense]].generation }; }
+	unsigned int indexOf(LightHandle handle) const { return slots[handle.index].dense; }
+
+	// call markDirty() after changing a light through get()
+	T& get(LightHandle handle) { return lights[slots[handle.index].dense]; }
+	void markDirty(LightHandle handle) { markDirty(slots[handle.index].dense); }
+	void markDirty(unsigned int dense) { dirtyBegin = std::min(dirtyBegin, dense); dirtyEnd = std::max(dirtyEnd, dense + 1); }
+	void markAllDirty() { dirtyBegin = 0; dirtyEnd = (unsigned int)lights.size(); }
+	bool dirty() const { return dirtyBegin < std::min(dirtyEnd, (unsigned int)lights.size()); }
+	void clearDirty() { dirtyBegin = UINT_MAX; dirtyEnd = 0; }
+
+	size_t size() const { return lights.size(); }
+	const T& operator[](unsigned int dense) const { return lights[dense]; }
+	T* data() { return lights.data(); }
+	typename std::vector<T>::const_iterator begin() const { return lights.begin(); }
+	typename std::vector<T>::const_iterator end() const { return lights.end(); }
+};
+
+// std140 layout of the Lights uniform block
+struct DirLightBlock {
+	DirLight dirLights[MAX_DIR_LIGHTS];
+	int dirLightCount, pad[3];
+};
+
+// Owns all scene lights and their GPU copies. Point and spot lights live in texture buffers whose capacity doubles
+// when they run out of room, upload() only sends their dirty ranges. Directional lights go to the Lights uniform
+// block, which is written to the ConstantRing every frame.
+class LightManager {
+public:
+	// texture units of the point and spot light buffers, next to the cluster buffers
+	static const unsigned int POINT_LIGHT_UNIT = 12, SPOT_LIGHT_UNIT = 13;
+
+	LightPool<PointLight> pointLights;
+	LightPool<SpotLight> spotLights;
+	LightPool<DirLight> dirLights;
+
+	// bytes of point and spot lights sent to the GPU by the last upload()
+	size_t lastUploadBytes = 0;
+
+	LightManager() {}
+	~LightManager();
+	LightManager(const LightManager&) = delete;
+	LightManager& operator=(const LightManager&) = delete;
+
+	void upload();
+	void bindTextures() const;
+	void renderUI();
+
+private:
+	struct LightBuffer {
+		unsigned int buffer = 0, texture = 0;
+		size_t capacity = 0; // in lights
+	};
+	LightBuffer pointBuffer, spotBuffer;
+
+	template<typename T>
+	void upload(LightPool<T>& pool, LightBuffer& buffer);
+
+	LightHandle selectedPoint, selectedSpot, selectedDir;
+};
+#endif
@@ -85,6 +85,10 @@ int main() {
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	ProgramCache::init((GLADloadproc)glfwGetProcAddress);
+	ShaderCompiler::init((GLADloadproc)glfwGetProcAddress);
+	ConstantRing::init((GLADloadproc)glfwGetProcAddress);
+	UploadQueue::init(window);
 
 	scene = std::make_shared<Scene>();
 
@@ -93,12 +97,12 @@ int main() {
 	light1.color = glm::vec4(2.0f);
 	light1.Linear = 0.35f;
 	light1.Quadratic = 0.44f;
-	scene->lights.pointLights[0] = light1;
+	scene->lights.pointLights.add(light1);
 
 	DirLight light2;
 	light2.dir = glm::normalize(glm::vec4(-1.0f, -2.0f, 0.5f, 0.0f));
 	light2.color = glm::vec4(0.5f);
-	scene->lights.dirLights[0] = light2;
+	scene->lights.dirLights.add(light2);
 
 	SpotLight light3;
 	light3.pos = glm::vec4(0.0f, 5.0f, 0.0f, 1.0f);
@@ -108,7 +112,7 @@ int main() {
 	light3.cutOff = glm::cos(glm::radians(20.0f));
 	light3.Linear = 0.0f;
 	light3.Quadratic = 0.0f;
-	scene->lights.spotLights[0] = light3;
+	scene->lights.spotLights.add(light3);
 
 	renderer = std::make_unique<Renderer>(SCR_WIDTH, SCR_HEIGHT, scene);
 
@@ -182,6 +186,12 @@ int main() {
 		ImGui::PlotLines("##framerate", &framerates[0], framerates.size(), 0, NULL, 0.0f, maxFramerateWindow, ImVec2(300, 100));
 		ImGui::SameLine();
 		ImGui::Text("Max FPS: %f\n\n\nAverage FPS: %.1f\n\n\nMin FPS: %f", maxFramerateWindow, averageFrameRateWindow, minFramerateWindow);
+		ImGui::Text("Transform update: %.3f ms (%zu transforms)", scene->transforms.lastUpdateTime, scene->transforms.size());
+		ImGui::Text("Render list: %.3f ms build, %.3f ms cull (%zu/%zu visible)", renderer->renderList->lastBuildTime, renderer->renderList->lastCullTime,
+			renderer->renderList->visible.size(), renderer->renderList->items.size());
+		ImGui::Text("Light assignment: %.3f ms (%u lights, %.2f avg / %u max per cluster)", renderer->lightClusters->lastAssignTime,
+			renderer->lightClusters->lightCount, renderer->lightClusters->averageLightsPerCluster, renderer->lightClusters->maxLightsPerCluster);
+		ImGui::Text("Light upload: %zu bytes", scene->lights.lastUploadBytes);
 
 		ImGui::End();
 
@@ -199,6 +209,7 @@ int main() {
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
 
+	UploadQueue::shutdown();
 	glfwTerminate();
 	return 0;
 }
@@ -6,14 +6,18 @@
 
 
 struct Texture {
-	unsigned int id;
-	int width, height;
+	unsigned int id = 0; // 0 until the UploadQueue is done with it
+	int width = 0, height = 0;
 	std::string type;
 	std::string path;
 	std::string name;
 
 	void renderUI() {
 		ImGui::LabelText(name.c_str(), type.c_str());
+		if (id == 0) {
+			ImGui::Text("Not uploaded");
+			return;
+		}
 		ImGui::Text("%d x %d", width, height);
 		ImGui::Image((ImTextureID)id, ImVec2(100.0f, 100.0f * (height / (float)width)));
 	}
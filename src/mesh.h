@@ -8,10 +8,13 @@
 
 #include "shader.h"
 #include "material.h"
+#include "uploadqueue.h"
 #include <imgui/imgui.h>
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <cstring>
 
 struct Vertex {
 	glm::vec3 Position;
@@ -21,6 +24,20 @@ struct Vertex {
 	glm::vec3 Bitangent;
 };
 
+struct AABB {
+	glm::vec3 min{ 0.0f };
+	glm::vec3 max{ 0.0f };
+
+	// bounds of this box after transforming it by m
+	AABB transform(const glm::mat4& m) const {
+		glm::vec3 center = glm::vec3(m * glm::vec4(0.5f * (min + max), 1.0f));
+		glm::vec3 extent = 0.5f * (max - min);
+		glm::mat3 absM = glm::mat3(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+		glm::vec3 newExtent = absM * extent;
+		return { center - newExtent, center + newExtent };
+	}
+};
+
 class Mesh {
 public:
 	// mesh data
@@ -28,6 +45,7 @@ public:
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::shared_ptr<Material> material;
+	AABB bounds;
 
 	Mesh(std::string& name, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::shared_ptr<Material> material) {
 		this->name = name;
@@ -35,37 +53,43 @@ public:
 		this->indices = indices;
 		this->material = material;
 
+		if (!vertices.empty()) {
+			bounds.min = bounds.max = vertices[0].Position;
+			for (auto& vertex : vertices) {
+				bounds.min = glm::min(bounds.min, vertex.Position);
+				bounds.max = glm::max(bounds.max, vertex.Position);
+			}
+		}
+
 		setupMesh();
 	}
 
+	// the buffers are filled by the UploadQueue, the mesh is skipped until they are
+	bool ready() {
+		if (VAO) return true;
+		if (!upload->ready) return false;
+		setupVertexArrays();
+		upload.reset();
+		return true;
+	}
+
 	void Draw() {
-		glActiveTexture(GL_TEXTURE0);
-		if (material->texture_diffuse)
-			glBindTexture(GL_TEXTURE_2D, material->texture_diffuse->id);
-		else
-			glBindTexture(GL_TEXTURE_2D, 0);
-		glActiveTexture(GL_TEXTURE1);
-		if (material->texture_specular)
-			glBindTexture(GL_TEXTURE_2D, material->texture_specular->id);
-		else
-			glBindTexture(GL_TEXTURE_2D, 0);
-		glActiveTexture(GL_TEXTURE2);
-		if (material->normal_map)
-			glBindTexture(GL_TEXTURE_2D, material->normal_map->id);
-		else
-			glBindTexture(GL_TEXTURE_2D, 0);
-
-		// draw mesh
-		glBindVertexArray(VAO);
+		if (!ready()) return;
+		// meshes sharing a material keep their textures bound, see GLState
+		GLState::bindTexture(0, GL_TEXTURE_2D, material->texture_diffuse ? material->texture_diffuse->id : 0);
+		GLState::bindTexture(1, GL_TEXTURE_2D, material->texture_specular ? material->texture_specular->id : 0);
+		GLState::bindTexture(2, GL_TEXTURE_2D, material->normal_map ? material->normal_map->id : 0);
+
+		// draw mesh, the VAO stays bound until the next draw replaces it
+		GLState::bindVertexArray(VAO);
 		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
 	}
 
+	// positions only, for shadow maps and other depth-only passes
 	void DrawDepth() {
-		// draw mesh without textures
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+		if (!ready()) return;
+		GLState::bindVertexArray(depthVAO);
+		glDrawElements(GL_TRIANGLES, indices.size(), depthIndexType, 0);
 	}
 
 	void renderUI() {
@@ -74,6 +98,7 @@ public:
 		ImGui::LabelText(name.c_str(), "Name");
 		ImGui::LabelText(std::to_string(vertices.size()).c_str(), "Vertices");
 		ImGui::LabelText(std::to_string(indices.size()).c_str(), "Indices");
+		ImGui::LabelText(std::to_string(depthVertexCount).c_str(), "Depth vertices");
 		
 		material->renderUI();
 
@@ -81,20 +106,33 @@ public:
 	}
 private:
 	// render data;
-	unsigned int VAO, VBO, EBO;
-
+	unsigned int VAO = 0, VBO, EBO;
+	// depth-only stream: unique positions, 12 bytes per vertex instead of sizeof(Vertex)
+	unsigned int depthVAO = 0, depthVBO, depthEBO;
+	unsigned int depthVertexCount = 0;
+	GLenum depthIndexType = GL_UNSIGNED_INT;
+	std::shared_ptr<UploadQueue::Upload> upload;
+
+	// Buffer names are shared with the upload context, vertex arrays are not, so only the buffers are filled by
+	// the upload thread and the vertex arrays are set up on the render thread once they are ready
 	void setupMesh() {
-		glGenVertexArrays(1, &VAO);
 		glGenBuffers(1, &VBO);
 		glGenBuffers(1, &EBO);
+		glGenBuffers(1, &depthVBO);
+		glGenBuffers(1, &depthEBO);
+
+		std::vector<std::pair<GLuint, std::vector<char>>> buffers;
+		buffers.emplace_back(VBO, UploadQueue::bytes(vertices));
+		buffers.emplace_back(EBO, UploadQueue::bytes(indices));
+		setupDepthStream(buffers);
+		upload = UploadQueue::buffers(std::move(buffers));
+	}
 
-		glBindVertexArray(VAO);
+	void setupVertexArrays() {
+		glGenVertexArrays(1, &VAO);
+		GLState::bindVertexArray(VAO);
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
 		// vertex positions
 		glEnableVertexAttribArray(0);
@@ -112,7 +150,55 @@ private:
 		glEnableVertexAttribArray(4);
 		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 
-		glBindVertexArray(0);
+		glGenVertexArrays(1, &depthVAO);
+		GLState::bindVertexArray(depthVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, depthVBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, depthEBO);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+		GLState::bindVertexArray(0);
+	}
+
+	// Vertices split by normal or UV seams are welded back together here, so the depth stream is smaller than
+	// the vertex buffer and neighbouring triangles share post-transform cache entries. Positions are compared bitwise.
+	void setupDepthStream(std::vector<std::pair<GLuint, std::vector<char>>>& buffers) {
+		struct PositionHash {
+			size_t operator()(const glm::vec3& p) const {
+				unsigned int bits[3];
+				std::memcpy(bits, &p, sizeof(bits));
+				return ((size_t)bits[0] * 73856093u) ^ ((size_t)bits[1] * 19349663u) ^ ((size_t)bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual {
+			bool operator()(const glm::vec3& a, const glm::vec3& b) const { return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0; }
+		};
+
+		std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> unique;
+		unique.reserve(vertices.size());
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> remap(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			auto inserted = unique.emplace(vertices[i].Position, (unsigned int)positions.size());
+			if (inserted.second) positions.push_back(vertices[i].Position);
+			remap[i] = inserted.first->second;
+		}
+		depthVertexCount = (unsigned int)positions.size();
+		buffers.emplace_back(depthVBO, UploadQueue::bytes(positions));
+
+		// 16 bit indices whenever the welded mesh fits
+		if (positions.size() <= 0xFFFF) {
+			std::vector<unsigned short> depthIndices(indices.size());
+			for (size_t i = 0; i < indices.size(); i++) depthIndices[i] = (unsigned short)remap[indices[i]];
+			buffers.emplace_back(depthEBO, UploadQueue::bytes(depthIndices));
+			depthIndexType = GL_UNSIGNED_SHORT;
+		}
+		else {
+			std::vector<unsigned int> depthIndices(indices.size());
+			for (size_t i = 0; i < indices.size(); i++) depthIndices[i] = remap[indices[i]];
+			buffers.emplace_back(depthEBO, UploadQueue::bytes(depthIndices));
+			depthIndexType = GL_UNSIGNED_INT;
+		}
 	}
 };
 #endif
\ No newline at end of file
@@ -201,21 +201,18 @@ std::shared_ptr<Texture> Model::loadMaterialTexture(const aiScene* scene, aiMate
 		}
 
 		auto texture = std::make_shared<Texture>();
-		int tex_width, tex_height;
 		if (auto tex = scene->GetEmbeddedTexture(str.C_Str())) {
-			texture->id = TextureEmbedded(tex, tex_width, tex_height);
+			TextureEmbedded(texture, tex);
 			std::string name = tex->mFilename.C_Str();
 			texture->name = (name != "") ? name : "tex" + std::to_string(textures_loaded.size());
 		}
 		else
 		{
-			texture->id = TextureFromFile(str.C_Str(), tex_width, tex_height, directory);
+			TextureFromFile(texture, str.C_Str(), directory);
 			std::string name = texture->path.substr(texture->path.find_last_of("/\\") + 1);
 			texture->name = (name != "") ? name : "tex" + std::to_string(textures_loaded.size());
 		}
 
-		texture->width = tex_width;
-		texture->height = tex_height;
 		texture->path = str.C_Str();
 		texture->type = typeName;
 		textures_loaded.push_back(texture);
@@ -225,79 +222,43 @@ std::shared_ptr<Texture> Model::loadMaterialTexture(const aiScene* scene, aiMate
 	return nullptr;
 }
 
-unsigned int Model::TextureFromFile(const char* path, int& width, int& height, const std::string& directory)
+// the image is decoded and uploaded by the UploadQueue, the texture keeps id 0 until then
+void Model::TextureFromFile(std::shared_ptr<Texture> texture, const char* path, const std::string& directory)
 {
-	std::string filename = std::string(path);
-	filename = directory + '/' + filename;
-
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format = GL_RED;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	UploadQueue::Image image;
+	image.file = directory + '/' + std::string(path);
+	uploadTexture(texture, std::move(image));
+}
 
-		stbi_image_free(data);
+// the scene is released after loading, so the embedded data is copied
+void Model::TextureEmbedded(std::shared_ptr<Texture> texture, const aiTexture* embedded) {
+	UploadQueue::Image image;
+	const unsigned char* data = (const unsigned char*)embedded->pcData;
+	if (embedded->mHeight == 0) {
+		// mWidth is the size of the compressed file
+		image.encoded.assign(data, data + embedded->mWidth);
 	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+	else {
+		image.pixels.assign(data, data + (size_t)embedded->mWidth * embedded->mHeight * sizeof(aiTexel));
+		image.width = embedded->mWidth;
+		image.height = embedded->mHeight;
+		image.format = GL_BGRA;
+		image.internalFormat = GL_RGBA8;
 	}
-
-	return textureID;
+	uploadTexture(texture, std::move(image));
 }
 
-unsigned int Model::TextureEmbedded(const aiTexture* texture, int& width, int& height) {
+void Model::uploadTexture(std::shared_ptr<Texture> texture, UploadQueue::Image image)
+{
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-
-	if (texture->mHeight == 0) {
-		int nrComponents;
-		unsigned char* data = stbi_load_from_memory((unsigned char*)texture->pcData, texture->mWidth / sizeof(unsigned char), &width, &height, &nrComponents, 0);
-		if (data) {
-			GLenum format = GL_RED;
-			if (nrComponents == 1)
-				format = GL_RED;
-			else if (nrComponents == 3)
-				format = GL_RGB;
-			else if (nrComponents == 4)
-				format = GL_RGBA;
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		}
-		else
-		{
-			printf("Failed to load from memory: %s\n", stbi_failure_reason());
+	UploadQueue::texture(textureID, std::move(image), [texture, textureID](const UploadQueue::Upload& upload) mutable {
+		if (upload.failed) {
+			GLState::deleteTextures(1, &textureID);
+			return;
 		}
-	}
-	else {
-		width = texture->mWidth; height = texture->mHeight;
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, texture->mWidth, texture->mHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, texture->pcData);
-	}
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	return textureID;
+		texture->id = textureID;
+		texture->width = upload.width;
+		texture->height = upload.height;
+	});
 }
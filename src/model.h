@@ -25,6 +25,7 @@ class Model
 public:
 	void Draw();
 	void DrawDepth();
+	std::vector<Mesh>& getMeshes() { return meshes; }
 	static std::shared_ptr<Model> loadModel(std::string path);
 	void renderUI();
 	static void renderLoadInfoUI();
@@ -50,7 +51,8 @@ private:
 	void processNode(aiNode* node, const aiScene* scene);
 	Mesh processMesh(aiMesh* mesh, const aiScene* scene);
 	std::shared_ptr<Texture> loadMaterialTexture(const aiScene* scene, aiMaterial* mat, aiTextureType type, std::string typeName);
-	unsigned int TextureFromFile(const char* path, int& width, int& height, const std::string& directory);
-	unsigned int TextureEmbedded(const aiTexture* texture, int& width, int& height);
+	void TextureFromFile(std::shared_ptr<Texture> texture, const char* path, const std::string& directory);
+	void TextureEmbedded(std::shared_ptr<Texture> texture, const aiTexture* embedded);
+	static void uploadTexture(std::shared_ptr<Texture> texture, UploadQueue::Image image);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include "pointshadows.h"
+
+#include <algorithm>
+#include <string>
+
+#include <imgui/imgui.h>
+
+PointShadowPass::PointShadowPass(unsigned int width, unsigned int height, std::shared_ptr<RenderList> renderList, std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene) : RenderPass(width, height)
+{
+	this->renderList = renderList;
+	this->camera = camera;
+	this->scene = scene;
+
+	for (unsigned int t = 0; t < POINT_SHADOW_TIERS; t++) {
+		tiers[t].resolution = 1024 >> t;
+		glGenTextures(1, &tiers[t].texture);
+		GLState::bindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, tiers[t].texture);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glGenFramebuffers(1, &tiers[t].fbo);
+
+		glGenTextures(1, &tiers[t].staticTexture);
+		GLState::bindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, tiers[t].staticTexture);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glGenFramebuffers(1, &tiers[t].staticFbo);
+	}
+	allocateTiers();
+	copier = std::make_unique<DepthLayerCopier>();
+
+	depthShader = std::make_unique<Shader>("src/shaders/pointshadow.vert", "src/shaders/pointshadow.geom", "src/shaders/pointshadow.frag");
+	depthShader->bindUniformBlock("Object", RenderList::OBJECT_BINDING);
+	depthShadowMatrices = depthShader->uniform<glm::mat4>("shadowMatrices");
+	depthLightPos = depthShader->uniform<glm::vec3>("lightPos");
+	depthRange = depthShader->uniform<float>("range");
+	depthLayer = depthShader->uniform<int>("layer");
+}
+
+PointShadowPass::~PointShadowPass()
+{
+	for (auto& tier : tiers) {
+		GLState::deleteTextures(1, &tier.texture);
+		GLState::deleteTextures(1, &tier.staticTexture);
+		GLState::deleteFramebuffers(1, &tier.fbo);
+		GLState::deleteFramebuffers(1, &tier.staticFbo);
+	}
+}
+
+// Every tier gets an equal share of the budget, so a 1024 tier holds a handful of lights and a 128 tier dozens.
+// 16 bit depth is plenty for distance / range. Each light takes two cubes, its shadow map and its static cache.
+void PointShadowPass::allocateTiers()
+{
+	memoryUsed = 0;
+	size_t tierBudget = (size_t)memoryBudget * 1024 * 1024 / POINT_SHADOW_TIERS;
+	for (auto& tier : tiers) {
+		size_t cubeSize = 6 * (size_t)tier.resolution * tier.resolution * 2;
+		unsigned int slots = (unsigned int)std::min(tierBudget / (2 * cubeSize), (size_t)1 << LAYER_BITS);
+		tier.owners.assign(slots, LightHandle());
+		tier.caches.assign(slots, LightCache());
+		tier.used = 0;
+
+		// an empty tier keeps a 1x1 cube so the sampler stays complete
+		unsigned int size = slots > 0 ? tier.resolution : 1;
+		memoryUsed += 2 * slots * cubeSize;
+		for (auto target : { std::make_pair(tier.texture, tier.fbo), std::make_pair(tier.staticTexture, tier.staticFbo) }) {
+			GLState::bindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, target.first);
+			glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT16, size, size, 6 * std::max(slots, 1u), 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+			GLState::bindFramebuffer(target.second);
+			glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target.first, 0);
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+				std::cout << "Framebuffer not complete!" << std::endl;
+		}
+	}
+	GLState::bindFramebuffer(0);
+}
+
+void PointShadowPass::setMemoryBudget(unsigned int megabytes)
+{
+	memoryBudget = megabytes;
+	allocateTiers();
+}
+
+void PointShadowPass::assignSlots()
+{
+	LightPool<PointLight>& lights = scene->lights.pointLights;
+	const unsigned int none = POINT_SHADOW_TIERS;
+
+	candidates.clear();
+	culledLights = 0;
+	if (enabled) {
+		Camera::Frustum frustum = camera->getFrustum();
+		Camera::Plane planes[6] = { frustum.topFace, frustum.bottomFace, frustum.rightFace, frustum.leftFace, frustum.farFace, frustum.nearFace };
+		for (auto& plane : planes)
+			plane.normal = glm::normalize(plane.normal);
+
+		for (unsigned int i = 0; i < lights.size(); i++) {
+			glm::vec3 pos(lights[i].pos);
+			float range = lights[i].radius();
+			bool outside = false;
+			for (auto& plane : planes)
+				outside |= glm::dot(plane.normal, pos - plane.point) < -range;
+			if (outside) {
+				culledLights++;
+				continue;
+			}
+			// radius on screen relative to half the screen height, up to the cot(fov / 2) factor
+			float importance = range / std::max(glm::length(pos - camera->Position), camera->ZNear);
+			candidates.push_back({ i, importance, none });
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.importance > b.importance; });
+	if (candidates.size() > maxShadowedLights)
+		candidates.resize(maxShadowedLights);
+
+	// smallest tier that covers the light's on-screen diameter, or the next smaller one with room left
+	float pixelScale = TARGET_HEIGHT / glm::tan(glm::radians(camera->Zoom) * 0.5f);
+	unsigned int remaining[POINT_SHADOW_TIERS];
+	for (unsigned int t = 0; t < POINT_SHADOW_TIERS; t++)
+		remaining[t] = (unsigned int)tiers[t].owners.size();
+	std::vector<unsigned int> tierOf(lights.size(), none);
+	for (auto& candidate : candidates) {
+		float pixels = candidate.importance * pixelScale;
+		unsigned int t = POINT_SHADOW_TIERS - 1;
+		while (t > 0 && tiers[t].resolution < pixels) t--;
+		while (t < POINT_SHADOW_TIERS && remaining[t] == 0) t++;
+		if (t == none) continue;
+		remaining[t]--;
+		candidate.tier = t;
+		tierOf[candidate.light] = t;
+	}
+
+	// free the layers of lights that were removed or changed tier, lights staying in their tier keep their layer
+	for (unsigned int t = 0; t < POINT_SHADOW_TIERS; t++) {
+		for (auto& owner : tiers[t].owners) {
+			if (owner.index == UINT_MAX) continue;
+			if (!lights.alive(owner) || tierOf[lights.indexOf(owner)] != t) {
+				owner = LightHandle();
+				tiers[t].used--;
+			}
+		}
+	}
+
+	for (auto& candidate : candidates) {
+		if (candidate.tier == none) continue;
+		Tier& tier = tiers[candidate.tier];
+		LightHandle handle = lights.handle(candidate.light);
+		int slot = (int)lights[candidate.light].shadowSlot;
+		unsigned int oldLayer = slot & ((1 << LAYER_BITS) - 1);
+		if (slot >= 0 && (unsigned int)slot >> LAYER_BITS == candidate.tier && oldLayer < tier.owners.size() && tier.owners[oldLayer] == handle)
+			continue;
+		unsigned int layer = 0;
+		while (tier.owners[layer].index != UINT_MAX) layer++;
+		tier.owners[layer] = handle;
+		tier.caches[layer] = LightCache();
+		tier.used++;
+	}
+
+	// write the new slots back, only lights whose slot changed are uploaded again
+	slots.assign(lights.size(), -1.0f);
+	shadowedLights = 0;
+	for (unsigned int t = 0; t < POINT_SHADOW_TIERS; t++) {
+		for (unsigned int layer = 0; layer < tiers[t].owners.size(); layer++) {
+			if (tiers[t].owners[layer].index == UINT_MAX) continue;
+			slots[lights.indexOf(tiers[t].owners[layer])] = (float)(t << LAYER_BITS | layer);
+			shadowedLights++;
+		}
+	}
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		if (lights[i].shadowSlot != slots[i]) {
+			lights.data()[i].shadowSlot = slots[i];
+			lights.markDirty(i);
+		}
+	}
+}
+
+void PointShadowPass::Render()
+{
+	drawnCasters = 0;
+	cachedLights = 0;
+	redrawnLights = 0;
+	if (shadowedLights == 0) return;
+
+	LightPool<PointLight>& lights = scene->lights.pointLights;
+	const glm::vec3 faceDirs[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	const glm::vec3 faceUps[6] = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+	auto touches = [](const AABB& bounds, const glm::vec3& pos, float range) {
+		glm::vec3 d = glm::max(bounds.min - pos, 0.0f) + glm::max(pos - bounds.max, 0.0f);
+		return glm::dot(d, d) <= range * range;
+	};
+
+	timer.begin();
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	depthShader->use();
+
+	for (auto& tier : tiers) {
+		if (tier.used == 0) continue;
+		glViewport(0, 0, tier.resolution, tier.resolution);
+
+		for (unsigned int layer = 0; layer < tier.owners.size(); layer++) {
+			if (tier.owners[layer].index == UINT_MAX) continue;
+			const PointLight& light = lights.get(tier.owners[layer]);
+			LightCache& cache = tier.caches[layer];
+			glm::vec3 pos(light.pos);
+			float range = light.radius();
+
+			// the cache is stale when the light moved or a static model changed within its range
+			if (cache.pos != pos || cache.range != range) cache.valid = false;
+			for (unsigned int i = 0; cache.valid && i < renderList->staticChanges.size(); i++)
+				if (touches(renderList->staticChanges[i], pos, range)) cache.valid = false;
+
+			staticCasters.clear();
+			dynamicCasters.clear();
+			for (unsigned int i = 0; i < renderList->items.size(); i++) {
+				RenderItem& item = renderList->items[i];
+				if (touches(item.bounds, pos, range))
+					(item.isStatic ? staticCasters : dynamicCasters).push_back(i);
+			}
+
+			bool staticStale = !cache.valid;
+			if (!staticStale && dynamicCasters.empty() && !cache.hadDynamic) {
+				cache.stats.hits++;
+				cachedLights++;
+				continue;
+			}
+
+			glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, range);
+			glm::mat4 shadowMatrices[6];
+			for (unsigned int face = 0; face < 6; face++)
+				shadowMatrices[face] = projection * glm::lookAt(pos, pos + faceDirs[face], faceUps[face]);
+			depthShader->set(depthShadowMatrices, shadowMatrices[0], 6);
+			depthShader->set(depthLightPos, pos);
+			depthShader->set(depthRange, range);
+			depthShader->set(depthLayer, (int)layer);
+
+			if (staticStale) {
+				copier->clear(tier.staticTexture, 6 * layer, 6);
+				GLState::bindFramebuffer(tier.staticFbo);
+				drawCasters(staticCasters);
+				cache.pos = pos;
+				cache.range = range;
+				cache.valid = true;
+				cache.stats.redraws++;
+				redrawnLights++;
+			}
+			else {
+				cache.stats.hits++;
+			}
+
+			copier->copy(tier.staticTexture, tier.texture, 6 * layer, 6, tier.resolution);
+			GLState::bindFramebuffer(tier.fbo);
+			drawCasters(dynamicCasters);
+			cache.hadDynamic = !dynamicCasters.empty();
+		}
+	}
+
+	GLState::bindFramebuffer(0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	timer.end();
+}
+
+void PointShadowPass::drawCasters(const std::vector<unsigned int>& items)
+{
+	for (unsigned int i : items) {
+		renderList->bindObject(i);
+		renderList->items[i].mesh->DrawDepth();
+	}
+	drawnCasters += (unsigned int)items.size();
+}
+
+void PointShadowPass::ResizeBuffers(unsigned int width, unsigned int height)
+{
+	// the atlas does not depend on the screen, only the tier choice does
+	TARGET_WIDTH = width; TARGET_HEIGHT = height;
+}
+
+void PointShadowPass::bindTextures() const
+{
+	for (unsigned int t = 0; t < POINT_SHADOW_TIERS; t++) {
+		GLState::bindTexture(FIRST_SHADOW_UNIT + t, GL_TEXTURE_CUBE_MAP_ARRAY, tiers[t].texture);
+	}
+}
+
+void PointShadowPass::renderUI()
+{
+	ImGui::Checkbox("Point light shadows", &enabled);
+	int budget = memoryBudget;
+	if (ImGui::SliderInt("Memory budget (MB)", &budget, 8, 512))
+		setMemoryBudget(budget);
+	int maxLights = maxShadowedLights;
+	if (ImGui::SliderInt("Max shadowed lights", &maxLights, 0, 256))
+		maxShadowedLights = maxLights;
+
+	ImGui::Text("%u lights shadowed, %u outside the view", shadowedLights, culledLights);
+	for (auto& tier : tiers)
+		ImGui::Text("%4u: %u / %zu cubes", tier.resolution, tier.used, tier.owners.size());
+	ImGui::Text("%.1f MB, %u casters drawn, %.3f ms GPU", memoryUsed / (1024.0f * 1024.0f), drawnCasters, timer.lastTime);
+	ImGui::Text("%u lights cached, %u static redraws", cachedLights, redrawnLights);
+	if (ImGui::TreeNode("Cache counters")) {
+		for (auto& tier : tiers)
+			for (unsigned int layer = 0; layer < tier.owners.size(); layer++)
+				if (tier.owners[layer].index != UINT_MAX)
+					ImGui::Text("Point light %u (%u): %u hits, %u redraws", tier.owners[layer].index, tier.resolution, tier.caches[layer].stats.hits, tier.caches[layer].stats.redraws);
+		ImGui::TreePop();
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef POINT_SHADOWS_H
+#define POINT_SHADOWS_H
+
+#include "renderpass.h"
+#include "camera.h"
+#include "gputimer.h"
+#include "renderlist.h"
+#include "scene.h"
+#include "shadowcache.h"
+
+// passed to the lighting shaders as a define
+#define POINT_SHADOW_TIERS 4
+
+// Omnidirectional shadows for point lights. The shadow atlas is one depth cube map array per resolution tier
+// (1024 down to 128), sized so all tiers together stay within memoryBudget.
+// Every frame the point lights whose range touches the view frustum are ranked by their projected size on screen,
+// the largest get the tier closest to their on-screen size and the rest fall back to smaller tiers until the
+// atlas is full. A light keeps its layer while it stays in the same tier.
+// Each light is drawn in one pass: a geometry shader instanced once per cube face routes triangles with gl_Layer.
+// The atlas stores distance / range, the slot of a light goes to the shader through PointLight::shadowSlot.
+// Every tier has a second cube array with the static casters of each light, see shadowcache.h. A light whose
+// cache is valid and that has no dynamic casters costs nothing.
+class PointShadowPass : public RenderPass
+{
+private:
+	struct LightCache {
+		glm::vec3 pos = glm::vec3(0.0f);
+		float range = 0.0f;
+		bool valid = false;
+		bool hadDynamic = false; // the shadow map holds more than the cache
+		ShadowCacheStats stats;
+	};
+
+	struct Tier {
+		unsigned int resolution;
+		unsigned int texture = 0, fbo = 0;
+		unsigned int staticTexture = 0, staticFbo = 0;
+		std::vector<LightHandle> owners; // light in each layer, invalid handle when free
+		std::vector<LightCache> caches;
+		unsigned int used = 0;
+	};
+	Tier tiers[POINT_SHADOW_TIERS];
+
+	struct Candidate {
+		unsigned int light; // dense index into the point light pool
+		float importance;
+		unsigned int tier;
+	};
+	std::vector<Candidate> candidates;
+	std::vector<float> slots;
+	std::vector<unsigned int> staticCasters, dynamicCasters;
+
+	std::unique_ptr<Shader> depthShader;
+	Shader::Uniform<glm::mat4> depthShadowMatrices;
+	Shader::Uniform<glm::vec3> depthLightPos;
+	Shader::Uniform<float> depthRange;
+	Shader::Uniform<int> depthLayer;
+	std::unique_ptr<DepthLayerCopier> copier;
+	std::shared_ptr<RenderList> renderList;
+	std::shared_ptr<Camera> camera;
+	std::shared_ptr<Scene> scene;
+
+	void allocateTiers();
+	void drawCasters(const std::vector<unsigned int>& items);
+
+public:
+	// texture units of the tiers, between the preprocess outputs and the cascaded shadow map
+	static const unsigned int FIRST_SHADOW_UNIT = 7;
+	static const unsigned int LAYER_BITS = 8; // shadowSlot = tier << LAYER_BITS | layer
+
+	// settings
+	unsigned int memoryBudget = 128; // MB, all tiers together
+	unsigned int maxShadowedLights = 32;
+	bool enabled = true;
+
+	// stats of the last frame
+	unsigned int shadowedLights = 0;
+	unsigned int culledLights = 0;
+	unsigned int drawnCasters = 0;
+	unsigned int cachedLights = 0;   // lights whose shadow map was left untouched
+	unsigned int redrawnLights = 0;  // lights whose static cache was drawn again
+	size_t memoryUsed = 0;
+	GpuTimer timer;
+
+	PointShadowPass(unsigned int width, unsigned int height, std::shared_ptr<RenderList> renderList, std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene);
+	~PointShadowPass();
+
+	// picks the shadowed lights and their tiers, call before the lights are uploaded
+	void assignSlots();
+	void Render() override;
+	void ResizeBuffers(unsigned int width, unsigned int height) override;
+
+	void setMemoryBudget(unsigned int megabytes);
+	void bindTextures() const;
+	void renderUI();
+};
+
+#endif
@@ -2,33 +2,22 @@
 #define POSTPROCESS_PASS_H
 
 #include "renderpass.h"
-#include "deferredlighting.h"
 
 const std::vector<std::string> postprocessEffects = { "Bloom" };
+// Effects between the lighting pass and tone mapping, they draw into "hdrColor" or produce textures the HDR pass
+// reads. Every output is a sampler uniform of the HDR shader with a bool <name>On next to it, and the render graph
+// texture it is read from.
 class PostprocessPass : public RenderPass {
 public:
 	struct OutputTexture {
-		unsigned int id;
 		std::string name;
-		int texture_unit;
-
-		OutputTexture(std::string name) {
-			this->name = name;
-			this->texture_unit = min_free_texture_unit;
-		}
+		std::string resource;
 	};
 
-protected:
-	std::shared_ptr<DeferredLightingPass> lighting;
-	static const unsigned int min_texture_unit = 1;
-	static unsigned int min_free_texture_unit;
-	static std::vector<bool> used_texture_units;
-
-public:
 	std::string name;
 	std::vector<OutputTexture> output_textures;
 
-	PostprocessPass(unsigned int width, unsigned int height, const std::shared_ptr<DeferredLightingPass> lighting, std::string name, std::vector<std::string> output_texture_names);
+	PostprocessPass(unsigned int width, unsigned int height, std::string name, std::vector<OutputTexture> output_textures);
 	virtual ~PostprocessPass();
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "programcache.h"
+
+#include <fstream>
+#include <iostream>
+
+unsigned int ProgramCache::loaded = 0, ProgramCache::compiled = 0, ProgramCache::rejected = 0;
+float ProgramCache::loadTime = 0.0f, ProgramCache::compileTime = 0.0f;
+std::map<uint64_t, ProgramCache::Entry> ProgramCache::entries;
+std::string ProgramCache::path;
+std::string ProgramCache::driver;
+PFNGLGETPROGRAMBINARYPROC ProgramCache::getProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC ProgramCache::programBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC ProgramCache::programParameteri = nullptr;
+
+void ProgramCache::init(GLADloadproc load, const std::string& path)
+{
+	ProgramCache::path = path;
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const char* value = (const char*)glGetString(name);
+		driver += value ? value : "";
+		driver += '\n';
+	}
+
+	// the driver has to support at least one binary format, core profiles from 4.1 on may still report none
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	getProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+	programBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+	programParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+	if (formats == 0 || !getProgramBinary || !programBinary || !programParameteri) {
+		std::cout << "Program binaries not supported, shaders are compiled from source" << std::endl;
+		getProgramBinary = nullptr;
+		programBinary = nullptr;
+		programParameteri = nullptr;
+		return;
+	}
+
+	// records of key, format, size and the binary, later records replace earlier ones
+	std::ifstream file(path, std::ios::binary);
+	uint64_t key;
+	uint32_t format, size;
+	while (file.read((char*)&key, sizeof(key)) && file.read((char*)&format, sizeof(format)) && file.read((char*)&size, sizeof(size))) {
+		Entry entry = { format, std::vector<char>(size) };
+		if (!file.read(entry.binary.data(), size)) break;
+		entries[key] = std::move(entry);
+	}
+}
+
+uint64_t ProgramCache::key(const std::vector<std::pair<GLenum, std::string>>& stages)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const char* data, size_t size) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ull;
+		}
+	};
+	add(driver.data(), driver.size());
+	for (auto& stage : stages) {
+		add((const char*)&stage.first, sizeof(stage.first));
+		add(stage.second.data(), stage.second.size());
+	}
+	return hash;
+}
+
+unsigned int ProgramCache::load(uint64_t key)
+{
+	auto it = entries.find(key);
+	if (!enabled() || it == entries.end()) return 0;
+
+	unsigned int program = glCreateProgram();
+	programBinary(program, it->second.format, it->second.binary.data(), (GLsizei)it->second.binary.size());
+	GLint success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		glDeleteProgram(program);
+		entries.erase(it);
+		rejected++;
+		return 0;
+	}
+	return program;
+}
+
+void ProgramCache::prepare(unsigned int program)
+{
+	if (enabled())
+		programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(uint64_t key, unsigned int program)
+{
+	GLint size = 0;
+	if (enabled()) glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size == 0) return;
+
+	Entry entry = { 0, std::vector<char>(size) };
+	getProgramBinary(program, size, nullptr, &entry.format, entry.binary.data());
+
+	std::ofstream file(path, std::ios::binary | std::ios::app);
+	uint32_t format = entry.format, length = (uint32_t)size;
+	file.write((const char*)&key, sizeof(key));
+	file.write((const char*)&format, sizeof(format));
+	file.write((const char*)&length, sizeof(length));
+	file.write(entry.binary.data(), size);
+	if (!file)
+		std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED: " << path << std::endl;
+	entries[key] = std::move(entry);
+}
+
+void ProgramCache::clear()
+{
+	entries.clear();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+}
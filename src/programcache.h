@@ -0,0 +1,48 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Linked shader programs kept on disk, so later runs skip compiling and linking. A program is keyed by a 64 bit FNV-1a
+// hash of its stage sources and the GL vendor, renderer and version strings, so a driver update or an edited shader
+// never loads a stale binary. A binary the driver rejects anyway falls back to a source compile and is replaced.
+// All entries live in one file that new binaries are appended to, stale entries stay until clear().
+// glGetProgramBinary/glProgramBinary are GL 4.1, the generated glad loader stops at 3.3, so init() loads them itself.
+class ProgramCache {
+public:
+	// stats since startup
+	static unsigned int loaded, compiled, rejected;
+	static float loadTime, compileTime; // ms, including reading the sources
+
+	// after the context is current, without it every program is compiled from source
+	static void init(GLADloadproc load, const std::string& path = "shadercache.bin");
+	static bool enabled() { return programBinary != nullptr; }
+
+	static uint64_t key(const std::vector<std::pair<GLenum, std::string>>& stages);
+	// a new linked program, or 0 when there is no binary or the driver rejects it
+	static unsigned int load(uint64_t key);
+	// call before linking a program that will be stored
+	static void prepare(unsigned int program);
+	static void store(uint64_t key, unsigned int program);
+	static void clear();
+
+private:
+	struct Entry {
+		GLenum format;
+		std::vector<char> binary;
+	};
+	static std::map<uint64_t, Entry> entries;
+	static std::string path;
+	static std::string driver;
+
+	static PFNGLGETPROGRAMBINARYPROC getProgramBinary;
+	static PFNGLPROGRAMBINARYPROC programBinary;
+	static PFNGLPROGRAMPARAMETERIPROC programParameteri;
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include<random>
+#include <cfloat>
+#include <chrono>
 
 #include <imgui/imgui.h>
 #include "renderer.h"
@@ -14,31 +16,61 @@ Renderer::Renderer(unsigned int width, unsigned int height, std::shared_ptr<Scen
 	TARGET_HEIGHT = height;
 	this->scene = scene;
 
+	jobSystem = std::make_shared<JobSystem>();
+	renderList = std::make_shared<RenderList>();
+	lightClusters = std::make_shared<LightClusters>();
 	camera = std::make_unique<Camera>(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 0.0f, 0.0f, width / (float)height, Camera::ProjectionType::Perspective);
 
 	// configure global opengl state
 	// -----------------------------
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthFunc(GL_LEQUAL);
 
-	initMatrices();
-	initLights();
+	gBufferPass = std::make_shared<GBufferPass>(width, height, renderList);
+	shadowPass = std::make_shared<ShadowMapPass>(2048, renderList, camera, scene, jobSystem);
+	pointShadowPass = std::make_shared<PointShadowPass>(width, height, renderList, camera, scene);
+	lightingPass = std::make_shared<DeferredLightingPass>(width, height, lightClusters, shadowPass, pointShadowPass, scene);
+	hdrPass = std::make_shared<HDRPass>(width, height);
 
-	gBufferPass = std::make_shared<GBufferPass>(width, height, scene);
-	lightingPass = std::make_shared<DeferredLightingPass>(width, height, gBufferPass);
-	hdrPass = std::make_shared<HDRPass>(width, height, lightingPass);
+	// optional passes compile their shaders now, toggling them only changes the render graph
+	ssao = std::make_shared<SSAOPass>(width, height);
+	ssr = std::make_shared<SSRPass>(width, height);
+	bloom = std::make_shared<BloomPass>(width, height);
+	skybox = std::make_shared<SkyboxPass>(width, height);
+	prefetchSkybox();
+
+	// a cold start compiles everything, a warm one should load every program from the cache
+	std::cout << "Shaders: " << ProgramCache::compiled << " compiled in " << ProgramCache::compileTime << " ms, "
+		<< ProgramCache::loaded << " loaded from the program cache in " << ProgramCache::loadTime << " ms" << std::endl;
+
+	renderGraph = std::make_shared<RenderGraph>(width, height);
+	renderGraph->addPass("G-buffer", gBufferPass);
+	renderGraph->addPass("Lighting", lightingPass);
+	renderGraph->addPass("HDR", hdrPass);
 }
 
 void Renderer::render()
 {
-	updateMatrices();
+	GLState::newFrame();
+	// programs compiling in the background, passes keep drawing with their previous variant until they are done
+	ShaderCompiler::poll();
+	// meshes that finished uploading are not in any static shadow cache yet
+	if (UploadQueue::poll())
+		scene->entities.removedStaticBounds.push_back({ glm::vec3(-FLT_MAX), glm::vec3(FLT_MAX) });
+
+	// scene extraction, shared by all geometry passes
+	scene->entities.flush();
+	scene->transforms.update(jobSystem.get());
+	renderList->build(*scene, *jobSystem);
+	renderList->cull(camera->getFrustum(), renderList->visible, *jobSystem);
+
+	beginFrameConstants();
+	pointShadowPass->assignSlots();
 	updateLights();
 
-	gBufferPass->Render();
-	for (std::shared_ptr<PreprocessPass> p : lightingPass->preprocessPasses) p->Render();
-	lightingPass->Render();
-	for (std::shared_ptr<PostprocessPass> p : hdrPass->postprocessPasses) p->Render();
-	hdrPass->Render();
+	shadowPass->Render();
+	pointShadowPass->Render();
+	renderGraph->execute();
 }
 
 void Renderer::renderUI()
@@ -68,6 +100,12 @@ void Renderer::renderUI()
 	}
 	if (skyboxLoadSuccess == LoadSuccess::failed)
 		ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Loading failed");
+	int budget = disabledEffectBudget;
+	if (ImGui::SliderInt("Keep disabled effects (MB)", &budget, 0, 256)) {
+		disabledEffectBudget = budget;
+		releaseDisabledEffects();
+	}
+	ImGui::Text("Skybox cubemap %.1f MB%s", skybox->memoryUsed / (1024.0f * 1024.0f), skybox->memoryUsed > 0 && !skyboxOn ? " (disabled)" : "");
 
 	if (ImGui::Combo("HDR Mode", &hdrPass->hdrMode, hdrPass->hdrModes, IM_ARRAYSIZE(hdrPass->hdrModes))) {
 		hdrPass->updateHDRMode();
@@ -78,52 +116,311 @@ void Renderer::renderUI()
 			hdrPass->updateExposure();
 	}
 
+	ImGui::SeparatorText("Render graph");
+	renderGraph->renderUI();
+
+	ImGui::SeparatorText("G-buffer");
+	gBufferPass->renderUI();
+	if (ImGui::Button("Time G-buffer passes"))
+		runGBufferBenchmark();
+	if (gBufferResults.gBuffer > 0.0f)
+		ImGui::Text("G-buffer %.3f ms, SSAO + SSR %.3f ms, lighting %.3f ms", gBufferResults.gBuffer, gBufferResults.preprocess, gBufferResults.lighting);
+
+	ImGui::SeparatorText("Lighting");
+	int lightingMode = (int)lightingPass->lightingMode;
+	if (ImGui::RadioButton("Clustered", &lightingMode, (int)DeferredLightingPass::LightingMode::Clustered) ||
+		ImGui::RadioButton("Light volumes", &lightingMode, (int)DeferredLightingPass::LightingMode::LightVolumes))
+		lightingPass->setLightingMode((DeferredLightingPass::LightingMode)lightingMode);
+	ImGui::Text("Lighting pass (GPU): %.3f ms", lightingPass->timer.lastTime);
+	if (ImGui::Button("Compare lighting modes"))
+		runLightingBenchmark();
+	for (auto& result : lightingResults)
+		ImGui::Text("%4u lights: clustered %7.3f ms (+%.3f ms CPU assignment), light volumes %7.3f ms",
+			result.lightCount, result.clustered, result.assignment, result.volumes);
+
+	ImGui::SeparatorText("Shadows");
+	shadowPass->renderUI();
+	if (ImGui::Button("Compare shadow filters"))
+		runShadowBenchmark();
+	for (auto& result : shadowResults)
+		ImGui::Text("%-8s %4u: shadow pass %7.3f ms, lighting %7.3f ms", shadowPass->filterNames[(int)result.filter],
+			result.resolution, result.shadows, result.lighting);
+	pointShadowPass->renderUI();
+
+	ImGui::SeparatorText("Shaders");
+	if (!ProgramCache::enabled())
+		ImGui::Text("Program binaries not supported");
+	ImGui::Text("%u programs compiled in %.1f ms, %u loaded from cache in %.1f ms, %u rejected", ProgramCache::compiled,
+		ProgramCache::compileTime, ProgramCache::loaded, ProgramCache::loadTime, ProgramCache::rejected);
+	if (ImGui::Button("Clear program cache"))
+		ProgramCache::clear();
+	ImGui::Text("Background compile: %s, %zu pending, %u finished in %.1f ms", ShaderCompiler::parallel() ? "parallel" : "one per frame",
+		ShaderCompiler::pending(), ShaderCompiler::finished, ShaderCompiler::finishTime);
+
+	ImGui::SeparatorText("GL state");
+	ImGui::Checkbox("Filter redundant state changes", &GLState::filtering);
+	unsigned int stateCalls = GLState::lastFrame.issued + GLState::lastFrame.filtered;
+	ImGui::Text("%u of %u calls filtered last frame (%.0f%%)", GLState::lastFrame.filtered, stateCalls,
+		stateCalls ? 100.0f * GLState::lastFrame.filtered / stateCalls : 0.0f);
+	ImGui::Text("Constant ring: %s, %.1f of %.1f KB last frame", ConstantRing::persistent ? "persistent" : "unsynchronized maps",
+		ConstantRing::lastFrameBytes / 1024.0f, ConstantRing::segmentSize / 1024.0f);
+	ImGui::Text("Waited %.3f ms for the GPU, %u overflows", ConstantRing::lastWaitTime, ConstantRing::overflows);
+
+	ImGui::SeparatorText("Asset uploads");
+	int uploadBudget = (int)(UploadQueue::budget >> 20);
+	if (ImGui::SliderInt("Upload budget (MB/frame, 0 = unlimited)", &uploadBudget, 0, 64))
+		UploadQueue::budget = (size_t)uploadBudget << 20;
+	ImGui::Text("%s, %zu pending, %u done", UploadQueue::threaded() ? "Upload thread" : "Render thread", UploadQueue::pending(), UploadQueue::completed);
+	ImGui::Text("%.2f MB last frame, %.1f MB total", UploadQueue::lastFrameBytes / (1024.0f * 1024.0f), UploadQueue::totalBytes / (1024.0f * 1024.0f));
+
+	ImGui::SeparatorText("Job system");
+	ImGui::Text("%u threads", jobSystem->threadCount());
+	if (ImGui::Button("Run scaling benchmark"))
+		runScalingBenchmark();
+	for (unsigned int i = 0; i < scalingResults.size(); i++) {
+		float speedup = scalingResults[0] / scalingResults[i];
+		ImGui::Text("%2u threads: %7.3f ms, speedup %.2fx, efficiency %3.0f%%", i + 1, scalingResults[i], speedup, 100.0f * speedup / (i + 1));
+	}
+
+	ImGui::SeparatorText("Entities");
+	ImGui::Text("%zu entities", scene->entities.size());
+	if (ImGui::Button("Run spawn benchmark"))
+		runSpawnBenchmark();
+	if (spawnResults.batchSpawn > 0.0f) {
+		ImGui::Text("Batch spawn:  %6.2f M entities/s", spawnResults.batchSpawn);
+		ImGui::Text("Single spawn: %6.2f M entities/s", spawnResults.singleSpawn);
+		ImGui::Text("Despawn:      %6.2f M entities/s", spawnResults.despawn);
+	}
+
 	ImGui::End();
 }
 
-void Renderer::initMatrices()
+// Starts the next frame of the constant ring and writes the camera matrices and the object blocks of the render list.
+// The benchmarks rebuild the render list and call this again, so their blocks get a segment of their own.
+void Renderer::beginFrameConstants()
 {
-	glGenBuffers(1, &uboMatrix);
-	glBindBuffer(GL_UNIFORM_BUFFER, uboMatrix);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, uboMatrix);
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(Camera::Matrices), &camera->matrices, GL_STATIC_DRAW);
+	// the object blocks of every item plus the camera, light and shadow blocks
+	ConstantRing::beginFrame(renderList->items.size() * ConstantRing::align(sizeof(ObjectBlock)) + (64 << 10));
+	ConstantRing::bind(0, ConstantRing::write(camera->matrices), sizeof(Camera::Matrices));
+	camera->projectionIsDirty = false;
+	camera->viewIsDirty = false;
+	renderList->uploadObjects();
 }
 
-void Renderer::updateMatrices()
+// light data only changes when lights are edited, the clusters depend on the view and are rebuilt every frame
+void Renderer::updateLights() {
+	scene->lights.upload();
+	lightClusters->build(*camera, scene->lights, *jobSystem);
+}
+
+// Times a full update of a synthetic 1M node hierarchy with 1 to N threads
+void Renderer::runScalingBenchmark()
 {
-	if (camera->projectionIsDirty) {
-		updateProjectionMatrix();
-		camera->projectionIsDirty = false;
+	TransformHierarchy transforms;
+	unsigned int root = transforms.add(TransformHierarchy::invalid);
+	std::default_random_engine generator;
+	std::uniform_real_distribution<float> randomFloats(-1.0f, 1.0f);
+
+	// nodes are only added below the most recent subtree, so every add is an append
+	for (unsigned int i = 0; i < 1000; i++) {
+		unsigned int subtreeRoot = transforms.add(root);
+		unsigned int last = subtreeRoot;
+		for (unsigned int j = 0; j < 999; j++) {
+			last = transforms.add((j % 8 == 0) ? subtreeRoot : last);
+			Transform transform{ &transforms, last };
+			transform.setLocalPosition(glm::vec3(randomFloats(generator), randomFloats(generator), randomFloats(generator)));
+			transform.setLocalRotation(glm::vec3(randomFloats(generator), randomFloats(generator), randomFloats(generator)) * 180.0f);
+		}
 	}
-	if (camera->viewIsDirty) {
-		updateViewMatrix();
-		camera->viewIsDirty = false;
+
+	const unsigned int runs = 5;
+	scalingResults.clear();
+	for (unsigned int threads = 1; threads <= jobSystem->threadCount(); threads++) {
+		JobSystem jobs(threads);
+		float total = 0.0f;
+		for (unsigned int run = 0; run <= runs; run++) {
+			std::fill(transforms.dirty.begin(), transforms.dirty.end(), true);
+			transforms.update(&jobs);
+			if (run > 0) total += transforms.lastUpdateTime; // first run is warm-up
+		}
+		scalingResults.push_back(total / runs);
+		std::cout << "Transform update, " << threads << " threads: " << scalingResults.back() << " ms, efficiency "
+			<< 100.0f * scalingResults[0] / (scalingResults.back() * threads) << "%" << std::endl;
 	}
 }
 
-void Renderer::updateProjectionMatrix()
+// Times the lighting pass on the GPU with 1, 100 and 1000 random point lights in each lighting mode.
+// The scene's own point and spot lights are restored afterwards.
+void Renderer::runLightingBenchmark()
 {
-	glBindBuffer(GL_UNIFORM_BUFFER, uboMatrix);
-	glBufferSubData(GL_UNIFORM_BUFFER, offsetof(Camera::Matrices, Camera::Matrices::projection), sizeof(glm::mat4), &camera->matrices.projection);
+	const unsigned int runs = 10;
+	LightPool<PointLight> pointLights = scene->lights.pointLights;
+	LightPool<SpotLight> spotLights = scene->lights.spotLights;
+	DeferredLightingPass::LightingMode mode = lightingPass->lightingMode;
+
+	scene->transforms.update(jobSystem.get());
+	renderList->build(*scene, *jobSystem);
+	renderList->cull(camera->getFrustum(), renderList->visible, *jobSystem);
+	beginFrameConstants();
+	renderGraph->executePass(gBufferPass.get());
+	for (std::shared_ptr<PreprocessPass> p : lightingPass->preprocessPasses) renderGraph->executePass(p.get());
+
+	lightingResults.clear();
+	for (unsigned int count : { 1u, 100u, 1000u }) {
+		scene->lights.pointLights.clear();
+		scene->lights.spotLights.clear();
+		scene->addRandomLights(count, false);
+		scene->lights.upload();
+
+		LightingResult result = { count, 0.0f, 0.0f, 0.0f };
+		for (auto m : { DeferredLightingPass::LightingMode::Clustered, DeferredLightingPass::LightingMode::LightVolumes }) {
+			lightingPass->setLightingMode(m);
+			// the mode change recompiles the graph, which may hand the G-buffer textures out differently
+			renderGraph->executePass(gBufferPass.get());
+			for (std::shared_ptr<PreprocessPass> p : lightingPass->preprocessPasses) renderGraph->executePass(p.get());
+			float total = 0.0f;
+			for (unsigned int run = 0; run <= runs; run++) {
+				if (m == DeferredLightingPass::LightingMode::Clustered) {
+					lightClusters->build(*camera, scene->lights, *jobSystem);
+					if (run > 0) result.assignment += lightClusters->lastAssignTime / runs;
+				}
+				renderGraph->executePass(lightingPass.get());
+				if (run > 0) total += lightingPass->timer.elapsed(); // first run is warm-up
+			}
+			(m == DeferredLightingPass::LightingMode::Clustered ? result.clustered : result.volumes) = total / runs;
+		}
+		lightingResults.push_back(result);
+		std::cout << "Lighting, " << count << " lights: clustered " << result.clustered << " ms (+" << result.assignment
+			<< " ms CPU assignment), light volumes " << result.volumes << " ms" << std::endl;
+	}
+
+	scene->lights.pointLights = pointLights;
+	scene->lights.spotLights = spotLights;
+	scene->lights.pointLights.markAllDirty();
+	scene->lights.spotLights.markAllDirty();
+	lightingPass->setLightingMode(mode);
 }
 
-void Renderer::updateViewMatrix()
+// Times the directional shadow pass and the lighting pass on the GPU with PCF 5x5 at the current resolution, and with
+// EVSM at the same and at half the resolution, where its blur gives about the same penumbra. Every run redraws all cascades.
+void Renderer::runShadowBenchmark()
 {
-	glBindBuffer(GL_UNIFORM_BUFFER, uboMatrix);
-	glBufferSubData(GL_UNIFORM_BUFFER, offsetof(Camera::Matrices, Camera::Matrices::view), sizeof(glm::mat4), &camera->matrices.view);
+	if (scene->lights.dirLights.size() == 0) {
+		std::cout << "Shadow benchmark needs a directional light" << std::endl;
+		return;
+	}
+	const unsigned int runs = 10;
+	ShadowMapPass::Filter filter = shadowPass->filter;
+	unsigned int resolution = shadowPass->resolution;
+	bool enabled = shadowPass->enabled;
+	shadowPass->enabled = true;
+
+	scene->transforms.update(jobSystem.get());
+	renderList->build(*scene, *jobSystem);
+	renderList->cull(camera->getFrustum(), renderList->visible, *jobSystem);
+	beginFrameConstants();
+	renderGraph->executePass(gBufferPass.get());
+	for (std::shared_ptr<PreprocessPass> p : lightingPass->preprocessPasses) renderGraph->executePass(p.get());
+
+	shadowResults = {
+		{ ShadowMapPass::Filter::PCF, resolution },
+		{ ShadowMapPass::Filter::EVSM, resolution },
+		{ ShadowMapPass::Filter::EVSM, glm::max(resolution / 2, 512u) },
+	};
+	for (auto& result : shadowResults) {
+		shadowPass->setFilter(result.filter);
+		shadowPass->setCascades(shadowPass->cascadeCount, result.resolution);
+		result.shadows = result.lighting = 0.0f;
+		for (unsigned int run = 0; run <= runs; run++) {
+			shadowPass->invalidate();
+			shadowPass->Render();
+			float shadowTime = shadowPass->timer.elapsed();
+			renderGraph->executePass(lightingPass.get());
+			float lightingTime = lightingPass->timer.elapsed();
+			if (run == 0) continue; // warm-up
+			result.shadows += shadowTime / runs;
+			result.lighting += lightingTime / runs;
+		}
+		std::cout << "Shadows, " << shadowPass->filterNames[(int)result.filter] << " " << result.resolution << ": shadow pass "
+			<< result.shadows << " ms, lighting " << result.lighting << " ms" << std::endl;
+	}
+
+	shadowPass->setFilter(filter);
+	shadowPass->setCascades(shadowPass->cascadeCount, resolution);
+	shadowPass->enabled = enabled;
 }
 
-void Renderer::initLights()
+// Times the G-buffer pass and its readers on the GPU: the preprocess passes and the lighting pass. Together with the
+// bytes per pixel this is the cost of the G-buffer layout.
+void Renderer::runGBufferBenchmark()
 {
-	glGenBuffers(1, &uboLights);
-	glBindBuffer(GL_UNIFORM_BUFFER, uboLights);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 1, uboLights);
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneLights), &scene->lights, GL_STATIC_DRAW);
+	const unsigned int runs = 10;
+	GpuTimer preprocessTimer;
+
+	scene->transforms.update(jobSystem.get());
+	renderList->build(*scene, *jobSystem);
+	renderList->cull(camera->getFrustum(), renderList->visible, *jobSystem);
+	beginFrameConstants();
+
+	gBufferResults = {};
+	for (unsigned int run = 0; run <= runs; run++) {
+		renderGraph->executePass(gBufferPass.get());
+		float gBufferTime = gBufferPass->timer.elapsed();
+		preprocessTimer.begin();
+		for (std::shared_ptr<PreprocessPass> p : lightingPass->preprocessPasses) renderGraph->executePass(p.get());
+		preprocessTimer.end();
+		float preprocessTime = preprocessTimer.elapsed();
+		renderGraph->executePass(lightingPass.get());
+		float lightingTime = lightingPass->timer.elapsed();
+		if (run == 0) continue; // warm-up
+		gBufferResults.gBuffer += gBufferTime / runs;
+		gBufferResults.preprocess += preprocessTime / runs;
+		gBufferResults.lighting += lightingTime / runs;
+	}
+	std::cout << "G-buffer, " << GBufferPass::BYTES_PER_PIXEL << " bytes per pixel: G-buffer " << gBufferResults.gBuffer
+		<< " ms, SSAO + SSR " << gBufferResults.preprocess << " ms, lighting " << gBufferResults.lighting << " ms" << std::endl;
 }
 
-void Renderer::updateLights() {
-	glBindBuffer(GL_UNIFORM_BUFFER, uboLights);
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneLights), &scene->lights, GL_STATIC_DRAW);
+// Spawns and destroys 100k entities in a scratch registry, once in batches and once one create() at a time
+void Renderer::runSpawnBenchmark()
+{
+	const unsigned int count = 100000, batch = 1000;
+	auto rate = [count](std::chrono::high_resolution_clock::time_point start) {
+		float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+		return count / seconds / 1000000.0f;
+	};
+
+	{
+		TransformHierarchy transforms;
+		EntityRegistry entities(&transforms);
+		EntityHandle root = entities.create(EntityHandle(), "root");
+		std::vector<EntityHandle> handles;
+		handles.reserve(count);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < count; i += batch)
+			entities.spawnBatch(root, batch, nullptr, handles);
+		spawnResults.batchSpawn = rate(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (auto handle : handles)
+			entities.destroy(handle);
+		entities.flush();
+		spawnResults.despawn = rate(start);
+	}
+	{
+		TransformHierarchy transforms;
+		EntityRegistry entities(&transforms);
+		EntityHandle root = entities.create(EntityHandle(), "root");
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < count; i++)
+			entities.create(root);
+		spawnResults.singleSpawn = rate(start);
+	}
+
+	std::cout << "Spawn " << count << " entities: batched " << spawnResults.batchSpawn << " M/s, single "
+		<< spawnResults.singleSpawn << " M/s, despawn " << spawnResults.despawn << " M/s" << std::endl;
 }
 
 void Renderer::framebuffer_size_callback(int width, int height)
@@ -131,63 +428,60 @@ void Renderer::framebuffer_size_callback(int width, int height)
 	TARGET_WIDTH = width;
 	TARGET_HEIGHT = height;
 
+	renderGraph->resize(width, height);
 	gBufferPass->ResizeBuffers(width, height);
-	for (std::shared_ptr<PreprocessPass> p : lightingPass->preprocessPasses) p->ResizeBuffers(width, height);
+	pointShadowPass->ResizeBuffers(width, height);
+	ssao->ResizeBuffers(width, height);
+	ssr->ResizeBuffers(width, height);
 	lightingPass->ResizeBuffers(width, height);
-	for (std::shared_ptr<PostprocessPass> p : hdrPass->postprocessPasses) p->ResizeBuffers(width, height);
+	bloom->ResizeBuffers(width, height);
+	skybox->ResizeBuffers(width, height);
 	hdrPass->ResizeBuffers(width, height);
 
 	camera->framebuffer_size_callback(width, height);
 }
 
+// The render targets of a disabled pass go back to the render graph's pool, so toggles only add or remove the pass
 void Renderer::toggleSSAO()
 {
-	if (ssaoOn) {
-		ssao = std::make_shared<SSAOPass>(TARGET_WIDTH, TARGET_HEIGHT, gBufferPass);
+	if (ssaoOn)
 		lightingPass->AddPreprocessPass(ssao);
-	}
-	else {
+	else
 		lightingPass->RemovePreprocessPass(ssao);
-		ssao.reset();
-	}
 }
 
 void Renderer::toggleSSR()
 {
-	if (ssrOn) {
-		ssr = std::make_shared<SSRPass>(TARGET_WIDTH, TARGET_HEIGHT, gBufferPass);
+	if (ssrOn)
 		lightingPass->AddPreprocessPass(ssr);
-	}
-	else {
+	else
 		lightingPass->RemovePreprocessPass(ssr);
-		ssr.reset();
-	}
 }
 
 void Renderer::toggleBloom()
 {
-	if (bloomOn) {
-		bloom = std::make_shared<BloomPass>(TARGET_WIDTH, TARGET_HEIGHT, lightingPass);
+	if (bloomOn)
 		hdrPass->AddPostprocessPass(bloom);
-	}
-	else {
+	else
 		hdrPass->RemovePostprocessPass(bloom);
-		bloom.reset();
-	}
 }
 
+// The cubemap is kept while the skybox is off, it is only loaded again when the directory or extension changed or
+// it was released. The faces are usually decoded by then, see prefetchSkybox().
 void Renderer::toggleSkybox()
 {
 	if (skyboxOn) {
-		std::string faces[6];
-		for (int i = 0; i < 6; i++) {
-			faces[i] = std::string(skyboxDir) + "/" + SkyboxPass::skybox_faces[i] + "." + std::string(skyboxImgExtension);
+		SkyboxPass::Faces wanted(skyboxDir, skyboxImgExtension);
+		if (skybox->source != wanted.source) {
+			if (!skyboxFaces || skyboxFaces->source != wanted.source)
+				prefetchSkybox();
+			jobSystem->wait(skyboxDecode);
+			skybox->load(*skyboxFaces);
+			skyboxFaces.reset();
 		}
-		skybox = std::make_shared<SkyboxPass>(0, 0, lightingPass, faces);
 		if (skybox->loadFailed) {
 			skyboxLoadSuccess = LoadSuccess::failed;
 			skyboxOn = false;
-			skybox.reset();
 		}
 		else {
 			skyboxLoadSuccess = LoadSuccess::successful;
@@ -196,6 +490,20 @@ void Renderer::toggleSkybox()
 	}
 	else {
 		hdrPass->RemovePostprocessPass(skybox);
-		skybox.reset();
+		releaseDisabledEffects();
 	}
 }
+
+void Renderer::prefetchSkybox()
+{
+	jobSystem->wait(skyboxDecode); // the jobs write into the current faces
+	skyboxFaces = std::make_unique<SkyboxPass::Faces>(skyboxDir, skyboxImgExtension);
+	skyboxFaces->decode(*jobSystem, skyboxDecode);
+}
+
+// SSAO, SSR and bloom only keep their shaders and the SSAO noise texture, the skybox cubemap is the one that counts
+void Renderer::releaseDisabledEffects()
+{
+	if (!skyboxOn && skybox->memoryUsed > (size_t)disabledEffectBudget * 1024 * 1024)
+		skybox->release();
+}
@@ -8,12 +8,18 @@
 #include "camera.h"
 #include "scene.h"
 #include "shader.h"
+#include "jobsystem.h"
+#include "renderlist.h"
+#include "lightclusters.h"
 
 #include "renderpass.h"
+#include "rendergraph.h"
 #include "preprocesspass.h"
 #include "postprocesspass.h"
 
 #include "gbuffer.h"
+#include "shadowmap.h"
+#include "pointshadows.h"
 #include "deferredlighting.h"
 #include "hdrpass.h"
 
@@ -28,12 +34,15 @@ private:
 		waiting, failed, successful
 	};
 
-	// Render passes
+	// Render passes, the screen space ones run in the render graph
+	std::shared_ptr<RenderGraph> renderGraph;
 	std::shared_ptr<GBufferPass> gBufferPass;
+	std::shared_ptr<ShadowMapPass> shadowPass;
+	std::shared_ptr<PointShadowPass> pointShadowPass;
 	std::shared_ptr<DeferredLightingPass> lightingPass;
 	std::shared_ptr<HDRPass> hdrPass;
 	
-	// Optional passes
+	// Optional passes, created up front and added to or removed from the render graph by the toggles
 	std::shared_ptr<SSAOPass> ssao;
 	std::shared_ptr<SSRPass> ssr;
 	std::shared_ptr<BloomPass> bloom;
@@ -43,33 +52,77 @@ private:
 	char skyboxDir[128] = "textures/skybox";
 	char skyboxImgExtension[4] = "jpg";
 	LoadSuccess skyboxLoadSuccess = waiting;
+	// faces decoded ahead of the toggle, starting with the default directory at startup
+	std::unique_ptr<SkyboxPass::Faces> skyboxFaces;
+	JobSystem::Counter skyboxDecode;
+	void prefetchSkybox();
+	// frees GPU memory of disabled effects above disabledEffectBudget
+	void releaseDisabledEffects();
 
-	// Matrix ubo
-	unsigned int uboMatrix;
+	// Matrices block and object blocks
+	void beginFrameConstants();
 
-	void initMatrices();
-	void updateMatrices();
-	void updateProjectionMatrix();
-	void updateViewMatrix();
-
-	// Light ubo
-	unsigned int uboLights;
-	void initLights();
+	// Light data and clusters
 	void updateLights();
 
+	// Job system scaling benchmark, time in ms per thread count
+	std::vector<float> scalingResults;
+	void runScalingBenchmark();
+
+	// Lighting benchmark, GPU time in ms of the lighting pass per mode
+	struct LightingResult {
+		unsigned int lightCount;
+		float clustered;
+		float assignment;
+		float volumes;
+	};
+	std::vector<LightingResult> lightingResults;
+	void runLightingBenchmark();
+
+	// Shadow filter benchmark, GPU time in ms of the directional shadow pass and the lighting pass
+	struct ShadowResult {
+		ShadowMapPass::Filter filter;
+		unsigned int resolution;
+		float shadows = 0.0f;
+		float lighting = 0.0f;
+	};
+	std::vector<ShadowResult> shadowResults;
+	void runShadowBenchmark();
+
+	// G-buffer benchmark, GPU time in ms of the passes that write or read the G-buffer
+	struct GBufferResults {
+		float gBuffer = 0.0f;
+		float preprocess = 0.0f; // SSAO and SSR, when enabled
+		float lighting = 0.0f;
+	} gBufferResults;
+	void runGBufferBenchmark();
+
+	// Entity spawn/despawn benchmark, throughput in millions of entities per second
+	struct SpawnResults {
+		float batchSpawn = 0.0f;
+		float singleSpawn = 0.0f;
+		float despawn = 0.0f;
+	} spawnResults;
+	void runSpawnBenchmark();
+
 public:
 	unsigned int TARGET_WIDTH, TARGET_HEIGHT;
 
 	std::shared_ptr<Scene> scene;
 	std::shared_ptr<Camera> camera;
+	std::shared_ptr<JobSystem> jobSystem;
+	std::shared_ptr<RenderList> renderList;
+	std::shared_ptr<LightClusters> lightClusters;
 
 	// UI settings
 	// Preprocess
-	bool ssaoOn, ssrOn;
+	bool ssaoOn = false, ssrOn = false;
 	// Postprocess
-	bool bloomOn;
+	bool bloomOn = false;
 	// Skybox
-	bool skyboxOn;
+	bool skyboxOn = false;
+	// MB of GPU memory disabled effects may keep so switching them on again is instant
+	unsigned int disabledEffectBudget = 64;
 
 	Renderer();
 	Renderer(unsigned int width, unsigned int height, std::shared_ptr<Scene> scene);
@@ -0,0 +1,390 @@
+#include "rendergraph.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <imgui/imgui.h>
+
+#include "renderpass.h"
+
+RenderGraph::Resource RenderGraph::Builder::create(const std::string& name, const TextureDesc& desc)
+{
+	Resource resource = graph.find(name);
+	ResourceNode& node = graph.resources[resource];
+	if (node.creator >= 0 || node.imported)
+		std::cout << "Render graph: " << name << " is created twice" << std::endl;
+	node.creator = pass;
+	node.desc = desc;
+	graph.passes[pass].outputs.push_back(resource);
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::Builder::importTexture(const std::string& name, unsigned int texture, GLenum target)
+{
+	Resource resource = graph.find(name);
+	ResourceNode& node = graph.resources[resource];
+	node.imported = true;
+	node.texture = texture;
+	node.target = target;
+	return resource;
+}
+
+int RenderGraph::Builder::read(const std::string& name)
+{
+	Resource resource = use(name);
+	auto& reads = graph.passes[pass].reads;
+	for (auto& read : reads)
+		if (read.first == resource) return read.second;
+
+	unsigned int unit = (unsigned int)reads.size();
+	if (unit >= MAX_UNITS)
+		std::cout << "Render graph: pass reads more than " << MAX_UNITS << " textures" << std::endl;
+	reads.push_back({ resource, unit });
+	return unit;
+}
+
+RenderGraph::Resource RenderGraph::Builder::modify(const std::string& name)
+{
+	Resource resource = graph.find(name);
+	graph.resources[resource].modifiers.push_back(pass);
+	graph.passes[pass].inputs.push_back(resource);
+	graph.passes[pass].outputs.push_back(resource);
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::Builder::use(const std::string& name)
+{
+	Resource resource = graph.find(name);
+	auto& readers = graph.resources[resource].readers;
+	if (std::find(readers.begin(), readers.end(), pass) == readers.end()) {
+		readers.push_back(pass);
+		graph.passes[pass].inputs.push_back(resource);
+	}
+	return resource;
+}
+
+void RenderGraph::Builder::sideEffect()
+{
+	graph.passes[pass].sideEffect = true;
+}
+
+RenderGraph::RenderGraph(unsigned int width, unsigned int height) : width(width), height(height)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	clearFramebuffers();
+	for (auto& texture : pool)
+		GLState::deleteTextures(1, &texture.id);
+}
+
+void RenderGraph::addPass(const std::string& name, std::shared_ptr<RenderPass> pass)
+{
+	pass->graph = this;
+	passes.push_back({ name, pass });
+	dirty = true;
+}
+
+void RenderGraph::removePass(std::shared_ptr<RenderPass> pass)
+{
+	passes.erase(std::remove_if(passes.begin(), passes.end(), [&](const PassNode& node) { return node.pass == pass; }), passes.end());
+	pass->graph = nullptr;
+	dirty = true;
+}
+
+void RenderGraph::resize(unsigned int width, unsigned int height)
+{
+	this->width = width;
+	this->height = height;
+	for (auto& texture : pool)
+		allocate(texture);
+	clearFramebuffers();
+}
+
+RenderGraph::Resource RenderGraph::find(const std::string& name)
+{
+	auto it = names.find(name);
+	if (it != names.end()) return it->second;
+	Resource resource = (Resource)resources.size();
+	resources.push_back({ name });
+	names[name] = resource;
+	return resource;
+}
+
+void RenderGraph::compile()
+{
+	resources.clear();
+	names.clear();
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		PassNode& node = passes[i];
+		node.reads.clear();
+		node.inputs.clear();
+		node.outputs.clear();
+		node.sideEffect = false;
+		Builder builder(*this, i);
+		node.pass->Setup(builder);
+	}
+	for (auto& resource : resources)
+		if (resource.creator < 0 && !resource.imported)
+			std::cout << "Render graph: nothing creates " << resource.name << std::endl;
+
+	sortPasses();
+	cullPasses();
+	assignTextures();
+	clearFramebuffers();
+	dirty = false;
+}
+
+// Kahn's algorithm, among the passes that are ready the one added first goes next
+void RenderGraph::sortPasses()
+{
+	std::vector<std::vector<unsigned int>> edges(passes.size());
+	std::vector<unsigned int> incoming(passes.size(), 0);
+	auto edge = [&](unsigned int from, unsigned int to) {
+		if (from == to) return;
+		edges[from].push_back(to);
+		incoming[to]++;
+	};
+	for (auto& resource : resources) {
+		if (resource.creator >= 0) {
+			for (unsigned int modifier : resource.modifiers) edge(resource.creator, modifier);
+			for (unsigned int reader : resource.readers) edge(resource.creator, reader);
+		}
+		for (unsigned int m = 0; m < resource.modifiers.size(); m++) {
+			if (m > 0) edge(resource.modifiers[m - 1], resource.modifiers[m]);
+			for (unsigned int reader : resource.readers) edge(resource.modifiers[m], reader);
+		}
+	}
+
+	order.clear();
+	std::vector<bool> done(passes.size(), false);
+	while (order.size() < passes.size()) {
+		unsigned int next = 0;
+		while (next < passes.size() && (done[next] || incoming[next] > 0)) next++;
+		if (next == passes.size()) {
+			std::cout << "Render graph: cycle between passes" << std::endl;
+			for (unsigned int i = 0; i < passes.size(); i++)
+				if (!done[i]) order.push_back(i);
+			break;
+		}
+		done[next] = true;
+		order.push_back(next);
+		for (unsigned int to : edges[next]) incoming[to]--;
+	}
+}
+
+// walks the order backwards, so every pass is decided before the passes it depends on
+void RenderGraph::cullPasses()
+{
+	for (auto& node : passes) node.live = node.sideEffect;
+	for (auto it = order.rbegin(); it != order.rend(); ++it) {
+		PassNode& node = passes[*it];
+		if (!node.live) continue;
+		for (Resource input : node.inputs) {
+			ResourceNode& resource = resources[input];
+			if (resource.creator >= 0) passes[resource.creator].live = true;
+			for (unsigned int modifier : resource.modifiers)
+				if (modifier != *it) passes[modifier].live = true;
+		}
+	}
+
+	livePasses = culledPasses = 0;
+	for (auto& node : passes) (node.live ? livePasses : culledPasses)++;
+}
+
+// Greedy interval allocation in execution order: a pool texture is handed to the next resource of its format as soon
+// as the last pass that needs its current holder has run
+void RenderGraph::assignTextures()
+{
+	for (auto& resource : resources) resource.first = resource.last = -1;
+	int position = 0;
+	for (unsigned int index : order) {
+		PassNode& node = passes[index];
+		if (!node.live) continue;
+		for (Resource output : node.outputs) {
+			ResourceNode& resource = resources[output];
+			if (resource.first < 0) resource.first = position;
+			resource.last = position;
+		}
+		for (Resource input : node.inputs) resources[input].last = position;
+		position++;
+	}
+
+	for (auto& texture : pool) {
+		texture.used = false;
+		texture.busyUntil = -1;
+	}
+	std::vector<Resource> transient;
+	for (Resource r = 0; r < (Resource)resources.size(); r++) {
+		resources[r].pooled = -1;
+		if (!resources[r].imported && resources[r].creator >= 0 && resources[r].first >= 0) transient.push_back(r);
+	}
+	std::sort(transient.begin(), transient.end(), [&](Resource a, Resource b) { return resources[a].first < resources[b].first; });
+
+	unaliasedBytes = 0;
+	for (Resource r : transient) {
+		ResourceNode& resource = resources[r];
+		unaliasedBytes += bytesPerPixel(resource.desc.internalFormat) * width * height;
+		int match = -1;
+		for (unsigned int i = 0; i < pool.size() && match < 0; i++)
+			if (pool[i].desc == resource.desc && pool[i].busyUntil < resource.first) match = i;
+		if (match < 0) {
+			pool.push_back({ resource.desc });
+			allocate(pool.back());
+			match = (int)pool.size() - 1;
+		}
+		pool[match].used = true;
+		pool[match].busyUntil = resource.last;
+		resource.pooled = match;
+	}
+
+	// textures of removed passes are released, the indices of the others shift
+	std::vector<int> remap(pool.size(), -1);
+	std::vector<PoolTexture> kept;
+	for (unsigned int i = 0; i < pool.size(); i++) {
+		if (pool[i].used) {
+			remap[i] = (int)kept.size();
+			kept.push_back(pool[i]);
+		}
+		else {
+			GLState::deleteTextures(1, &pool[i].id);
+		}
+	}
+	pool = kept;
+	poolBytes = 0;
+	for (auto& texture : pool) poolBytes += bytesPerPixel(texture.desc.internalFormat) * width * height;
+	for (auto& resource : resources)
+		if (resource.pooled >= 0) resource.pooled = remap[resource.pooled];
+}
+
+void RenderGraph::allocate(PoolTexture& texture)
+{
+	if (texture.id == 0) {
+		glGenTextures(1, &texture.id);
+		GLState::bindTexture(GL_TEXTURE_2D, texture.id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.desc.filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.desc.filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	GLState::bindTexture(GL_TEXTURE_2D, texture.id);
+	glTexImage2D(GL_TEXTURE_2D, 0, texture.desc.internalFormat, width, height, 0, texture.desc.format, texture.desc.type, NULL);
+}
+
+void RenderGraph::clearFramebuffers()
+{
+	for (auto& framebuffer : framebuffers)
+		GLState::deleteFramebuffers(1, &framebuffer.second);
+	framebuffers.clear();
+}
+
+void RenderGraph::execute()
+{
+	if (dirty) compile();
+	for (unsigned int index : order) {
+		PassNode& node = passes[index];
+		if (!node.live) continue;
+		bindReads(node);
+		node.pass->Render();
+	}
+}
+
+void RenderGraph::executePass(RenderPass* pass)
+{
+	if (dirty) compile();
+	for (auto& node : passes) {
+		if (node.pass.get() != pass || !node.live) continue;
+		bindReads(node);
+		node.pass->Render();
+	}
+}
+
+void RenderGraph::bindReads(const PassNode& node)
+{
+	for (auto& read : node.reads) {
+		GLState::bindTexture(read.second, resources[read.first].target, texture(read.first));
+	}
+}
+
+unsigned int RenderGraph::texture(Resource resource) const
+{
+	const ResourceNode& node = resources[resource];
+	if (node.imported) return node.texture;
+	return node.pooled >= 0 ? pool[node.pooled].id : 0;
+}
+
+void RenderGraph::bindFramebuffer(std::initializer_list<Resource> colors, Resource depth)
+{
+	GLState::bindFramebuffer(framebuffer(colors, depth));
+}
+
+void RenderGraph::copyDepth(Resource source, Resource destination)
+{
+	GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer({}, source));
+	GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer({}, destination));
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	GLState::bindFramebuffer(0);
+}
+
+// the cached framebuffer with these attachments, a new one is created (and left bound) the first time
+unsigned int RenderGraph::framebuffer(std::initializer_list<Resource> colors, Resource depth)
+{
+	std::vector<unsigned int> key;
+	for (Resource color : colors) key.push_back(texture(color));
+	key.push_back(depth == NONE ? 0 : texture(depth));
+
+	auto it = framebuffers.find(key);
+	if (it != framebuffers.end()) return it->second;
+
+	unsigned int fbo;
+	glGenFramebuffers(1, &fbo);
+	GLState::bindFramebuffer(fbo);
+	std::vector<GLenum> attachments;
+	for (Resource color : colors) {
+		attachments.push_back(GL_COLOR_ATTACHMENT0 + (GLenum)attachments.size());
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachments.back(), GL_TEXTURE_2D, texture(color), 0);
+	}
+	glDrawBuffers((GLsizei)attachments.size(), attachments.data());
+	// depth only, a read buffer without an attachment makes it incomplete before GL 4.1
+	if (attachments.empty()) glReadBuffer(GL_NONE);
+	if (depth != NONE) {
+		GLenum attachment = resources[depth].desc.format == GL_DEPTH_STENCIL ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture(depth), 0);
+	}
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Framebuffer not complete!" << std::endl;
+	framebuffers[key] = fbo;
+	return fbo;
+}
+
+size_t RenderGraph::bytesPerPixel(GLenum internalFormat)
+{
+	switch (internalFormat) {
+	case GL_R8: return 1;
+	case GL_R16F: case GL_RG8: return 2;
+	case GL_RGBA8: case GL_RG16: case GL_RG16F: case GL_R32F: case GL_DEPTH24_STENCIL8: case GL_DEPTH_COMPONENT32F: return 4;
+	case GL_RGBA16F: case GL_RG32F: return 8;
+	case GL_RGBA32F: return 16;
+	default: return 4;
+	}
+}
+
+void RenderGraph::renderUI()
+{
+	ImGui::Text("%u passes, %u culled, render targets %.1f MB (%.1f MB without aliasing)", livePasses, culledPasses,
+		poolBytes / (1024.0f * 1024.0f), unaliasedBytes / (1024.0f * 1024.0f));
+	if (!ImGui::TreeNode("Passes")) return;
+	for (unsigned int index : order) {
+		const PassNode& node = passes[index];
+		std::string line = node.name;
+		if (!node.live) line += " (culled)";
+		for (Resource output : node.outputs) {
+			const ResourceNode& resource = resources[output];
+			line += "  " + resource.name;
+			if (resource.pooled >= 0) line += " [#" + std::to_string(resource.pooled) + "]";
+		}
+		ImGui::BulletText("%s", line.c_str());
+	}
+	ImGui::TreePop();
+}
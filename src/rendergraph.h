@@ -0,0 +1,142 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <glad/glad.h>
+
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class RenderPass;
+
+// Frame graph of the screen space passes. Every pass declares in Setup() which textures it creates, reads, modifies
+// or binds itself, by name, and compile() turns that into a frame:
+//  - passes are ordered creator, then modifiers, then readers of every texture, otherwise in the order they were added
+//  - passes whose outputs nobody reads are culled, starting from the passes with side effects (drawing to the screen)
+//  - created textures are transient: they come from a pool, and textures with the same format whose lifetimes do not
+//    overlap share one allocation. Their contents are undefined until the creating pass writes them.
+//  - every read gets a texture unit, the texture is bound to it before the pass runs
+// The graph only changes when passes are added or removed or change their declarations, so compile() runs rarely.
+// Shadow maps stay outside of it since they are cached across frames.
+class RenderGraph {
+public:
+	using Resource = int;
+	static const Resource NONE = -1;
+	// reads get units 0 to MAX_UNITS - 1, the units above belong to shadow maps and light data
+	static const unsigned int MAX_UNITS = 6;
+
+	// screen sized 2D texture
+	struct TextureDesc {
+		GLenum internalFormat, format, type;
+		GLenum filter = GL_NEAREST;
+
+		bool operator==(const TextureDesc& other) const {
+			return internalFormat == other.internalFormat && format == other.format && type == other.type && filter == other.filter;
+		}
+	};
+
+	// handed to RenderPass::Setup()
+	class Builder {
+	private:
+		friend class RenderGraph;
+		RenderGraph& graph;
+		unsigned int pass;
+		Builder(RenderGraph& graph, unsigned int pass) : graph(graph), pass(pass) {}
+
+	public:
+		// a new transient texture written by this pass
+		Resource create(const std::string& name, const TextureDesc& desc);
+		// a texture owned by the pass itself, e.g. a lookup table, so it can be read like any other
+		Resource importTexture(const std::string& name, unsigned int texture, GLenum target = GL_TEXTURE_2D);
+		// sampled by this pass, returns the texture unit it is bound to
+		int read(const std::string& name);
+		// written on top of what an earlier pass created
+		Resource modify(const std::string& name);
+		// needed by this pass but bound by the pass itself: framebuffer attachments, ping-pong inputs
+		Resource use(const std::string& name);
+		// never culled
+		void sideEffect();
+	};
+
+	// stats of the last compile
+	unsigned int livePasses = 0, culledPasses = 0;
+	size_t poolBytes = 0;      // render target memory of the pool
+	size_t unaliasedBytes = 0; // the same without sharing
+
+	RenderGraph(unsigned int width, unsigned int height);
+	~RenderGraph();
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	void addPass(const std::string& name, std::shared_ptr<RenderPass> pass);
+	void removePass(std::shared_ptr<RenderPass> pass);
+	// runs Setup() of every pass again before the next frame
+	void invalidate() { dirty = true; }
+	void resize(unsigned int width, unsigned int height);
+
+	void execute();
+	// runs a single pass with its inputs bound, for benchmarks. The graph must have been executed before.
+	void executePass(RenderPass* pass);
+
+	unsigned int texture(Resource resource) const;
+	// binds a cached framebuffer with these attachments, depth can be a depth or depth-stencil texture
+	void bindFramebuffer(std::initializer_list<Resource> colors, Resource depth = NONE);
+	// blits depth between two textures of the same format, leaves GL_FRAMEBUFFER unbound
+	void copyDepth(Resource source, Resource destination);
+
+	void renderUI();
+
+private:
+	struct ResourceNode {
+		std::string name;
+		TextureDesc desc = {};
+		bool imported = false;
+		unsigned int texture = 0; // imported only
+		GLenum target = GL_TEXTURE_2D;
+		int creator = -1;
+		std::vector<unsigned int> modifiers = {};
+		std::vector<unsigned int> readers = {}; // reads and uses
+		int first = -1, last = -1;         // lifetime, positions in the execution order
+		int pooled = -1;
+	};
+
+	struct PassNode {
+		std::string name;
+		std::shared_ptr<RenderPass> pass;
+		std::vector<std::pair<Resource, unsigned int>> reads = {}; // and their units
+		std::vector<Resource> inputs = {}, outputs = {};
+		bool sideEffect = false;
+		bool live = false;
+	};
+
+	struct PoolTexture {
+		TextureDesc desc;
+		unsigned int id = 0;
+		int busyUntil = -1; // last position the current holder needs it
+		bool used = false;
+	};
+
+	std::vector<PassNode> passes;
+	std::vector<ResourceNode> resources;
+	std::map<std::string, Resource> names;
+	std::vector<unsigned int> order;
+	std::vector<PoolTexture> pool;
+	std::map<std::vector<unsigned int>, unsigned int> framebuffers;
+	unsigned int width, height;
+	bool dirty = true;
+
+	Resource find(const std::string& name);
+	unsigned int framebuffer(std::initializer_list<Resource> colors, Resource depth);
+	void compile();
+	void sortPasses();
+	void cullPasses();
+	void assignTextures();
+	void allocate(PoolTexture& texture);
+	void clearFramebuffers();
+	void bindReads(const PassNode& node);
+	static size_t bytesPerPixel(GLenum internalFormat);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "renderlist.h"
+
+#include <cfloat>
+#include <chrono>
+
+void RenderList::build(Scene& scene, JobSystem& jobs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// reserve a slot per mesh first, so workers can fill the list without synchronising
+	unsigned int count = 0;
+	offsets.clear();
+	for (auto& archetype : scene.entities.archetypes) {
+		if (!(archetype.mask & COMPONENT_MODEL)) continue;
+		for (Model* model : archetype.models) {
+			offsets.push_back(count);
+			count += (unsigned int)model->getMeshes().size();
+		}
+	}
+	items.resize(count);
+
+	staticChanges.swap(scene.entities.removedStaticBounds);
+	scene.entities.removedStaticBounds.clear();
+
+	// linear scans over the model, bounds and transform columns of every archetype that has a model
+	TransformHierarchy& transforms = scene.transforms;
+	unsigned int base = 0;
+	for (auto& archetype : scene.entities.archetypes) {
+		if (!(archetype.mask & COMPONENT_MODEL)) continue;
+		bool isStatic = (archetype.mask & COMPONENT_STATIC) != 0;
+
+		// old bounds of moved static models, before they are overwritten below
+		size_t firstChange = staticChanges.size();
+		changedRows.clear();
+		if (isStatic) {
+			for (unsigned int row = 0; row < archetype.size(); row++) {
+				if (!transforms.changed[transforms.node(archetype.transforms[row])]) continue;
+				staticChanges.push_back(archetype.bounds[row]);
+				changedRows.push_back(row);
+			}
+		}
+
+		jobs.parallelFor((unsigned int)archetype.size(), 64, [this, &archetype, &transforms, base, isStatic](unsigned int begin, unsigned int end) {
+			for (unsigned int row = begin; row < end; row++) {
+				unsigned int node = transforms.node(archetype.transforms[row]);
+				const glm::mat4& model = transforms.modelMatrices[node];
+				const glm::mat3& normal = transforms.normalMatrices[node];
+
+				RenderItem* item = &items[offsets[base + row]];
+				AABB bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+				for (auto& mesh : archetype.models[row]->getMeshes()) {
+					item->mesh = &mesh;
+					item->material = mesh.material.get();
+					item->model = model;
+					item->normal = normal;
+					item->bounds = mesh.bounds.transform(model);
+					item->isStatic = isStatic;
+					bounds.min = glm::min(bounds.min, item->bounds.min);
+					bounds.max = glm::max(bounds.max, item->bounds.max);
+					item++;
+				}
+				archetype.bounds[row] = bounds;
+			}
+		});
+
+		for (unsigned int i = 0; i < changedRows.size(); i++) {
+			AABB& change = staticChanges[firstChange + i];
+			change.min = glm::min(change.min, archetype.bounds[changedRows[i]].min);
+			change.max = glm::max(change.max, archetype.bounds[changedRows[i]].max);
+		}
+		base += (unsigned int)archetype.size();
+	}
+
+	lastBuildTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void RenderList::cull(const Camera::Frustum& frustum, std::vector<unsigned int>& out, JobSystem& jobs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	visibleFlags.resize(items.size());
+	jobs.parallelFor((unsigned int)items.size(), 1024, [this, &frustum](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++)
+			visibleFlags[i] = intersects(frustum, items[i].bounds);
+	});
+
+	out.clear();
+	for (unsigned int i = 0; i < items.size(); i++)
+		if (visibleFlags[i]) out.push_back(i);
+
+	lastCullTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// conservative test: the box is rejected only if it lies entirely behind one of the planes
+bool RenderList::intersects(const Camera::Frustum& frustum, const AABB& bounds)
+{
+	const Camera::Plane* planes[6] = { &frustum.topFace, &frustum.bottomFace, &frustum.rightFace,
+		&frustum.leftFace, &frustum.farFace, &frustum.nearFace };
+	for (auto plane : planes) {
+		// corner of the box furthest along the plane normal
+		glm::vec3 p(plane->normal.x >= 0.0f ? bounds.max.x : bounds.min.x,
+			plane->normal.y >= 0.0f ? bounds.max.y : bounds.min.y,
+			plane->normal.z >= 0.0f ? bounds.max.z : bounds.min.z);
+		if (glm::dot(plane->normal, p - plane->point) < 0.0f) return false;
+	}
+	return true;
+}
+
+void RenderList::uploadObjects()
+{
+	objectStride = ConstantRing::align(sizeof(ObjectBlock));
+	if (items.empty()) return;
+	char* data = (char*)ConstantRing::allocate(objectStride * items.size(), objectOffset);
+	for (size_t i = 0; i < items.size(); i++) {
+		ObjectBlock* block = (ObjectBlock*)(data + i * objectStride);
+		block->model = items[i].model;
+		for (unsigned int c = 0; c < 3; c++)
+			block->normal[c] = glm::vec4(items[i].normal[c], 0.0f);
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef RENDERLIST_H
+#define RENDERLIST_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "camera.h"
+#include "constantring.h"
+#include "jobsystem.h"
+#include "mesh.h"
+#include "scene.h"
+
+// Everything a geometry pass needs to draw one mesh, copied out of the scene so passes never touch entities
+struct RenderItem {
+	Mesh* mesh;
+	Material* material;
+	glm::mat4 model;
+	glm::mat3 normal;
+	AABB bounds; // world space
+	bool isStatic;
+};
+
+// std140 layout of the Object uniform block
+struct ObjectBlock {
+	glm::mat4 model;
+	glm::vec4 normal[3]; // mat3 columns are 16 bytes apart
+};
+
+// Per-frame list of drawable meshes. It is extracted once after the transform update and then shared by every
+// geometry pass; each view (camera, shadow cascade, ...) culls it into its own list of item indices.
+class RenderList {
+private:
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned char> visibleFlags;
+	std::vector<unsigned int> changedRows;
+
+public:
+	std::vector<RenderItem> items;
+	std::vector<unsigned int> visible; // items inside the camera frustum
+	// world bounds covering where static models were and are now, for every static model that moved, appeared or
+	// disappeared since the last build(). Shadow caches overlapping one of them are stale.
+	std::vector<AABB> staticChanges;
+
+	float lastBuildTime = 0.0f;
+	float lastCullTime = 0.0f;
+
+	// the items' Object blocks in the ConstantRing, one every objectStride bytes
+	static const unsigned int OBJECT_BINDING = 6;
+	GLintptr objectOffset = 0;
+	size_t objectStride = 0;
+
+	void build(Scene& scene, JobSystem& jobs);
+	// writes the model and normal matrices of every item, after build(). All geometry passes draw with them.
+	void uploadObjects();
+	void bindObject(unsigned int item) const
+	{
+		ConstantRing::bind(OBJECT_BINDING, objectOffset + item * objectStride, sizeof(ObjectBlock));
+	}
+	void cull(const Camera::Frustum& frustum, std::vector<unsigned int>& out, JobSystem& jobs);
+
+	static bool intersects(const Camera::Frustum& frustum, const AABB& bounds);
+};
+#endif
@@ -1,7 +1,28 @@
 #include "renderpass.h"
 
+#include <glm/gtc/constants.hpp>
+
 unsigned int RenderPass::quadVAO; unsigned int RenderPass::quadVBO;
 unsigned int RenderPass::cubeVAO; unsigned int RenderPass::cubeVBO;
+unsigned int RenderPass::sphereVAO; unsigned int RenderPass::sphereVBO; unsigned int RenderPass::sphereEBO; unsigned int RenderPass::sphereIndexCount;
+unsigned int RenderPass::coneVAO; unsigned int RenderPass::coneVBO; unsigned int RenderPass::coneEBO; unsigned int RenderPass::coneIndexCount;
+
+namespace {
+	void createIndexedMesh(unsigned int& VAO, unsigned int& VBO, unsigned int& EBO, const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices)
+	{
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+		GLState::bindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		GLState::bindVertexArray(0);
+	}
+}
 void RenderPass::RenderQuad()
 {
 	if (quadVAO == 0)
@@ -16,7 +37,7 @@ void RenderPass::RenderQuad()
 		// setup plane VAO
 		glGenVertexArrays(1, &quadVAO);
 		glGenBuffers(1, &quadVBO);
-		glBindVertexArray(quadVAO);
+		GLState::bindVertexArray(quadVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
 		glEnableVertexAttribArray(0);
@@ -24,9 +45,8 @@ void RenderPass::RenderQuad()
 		glEnableVertexAttribArray(1);
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	}
-	glBindVertexArray(quadVAO);
+	GLState::bindVertexArray(quadVAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
 }
 
 // renderCube() renders a 1x1 3D cube in NDC.
@@ -86,14 +106,74 @@ void RenderPass::RenderCube()
 		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 		// link vertex attributes
-		glBindVertexArray(cubeVAO);
+		GLState::bindVertexArray(cubeVAO);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::bindVertexArray(0);
 	}
 	// render cube
-	glBindVertexArray(cubeVAO);
+	GLState::bindVertexArray(cubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
 }
+
+// renderSphere() renders a sphere that encloses the unit sphere, used as a point light volume.
+// The vertices are pushed out so the flat faces never cut into the unit sphere.
+// -------------------------------------------------
+void RenderPass::RenderSphere()
+{
+	if (sphereVAO == 0)
+	{
+		const unsigned int segments = 16, rings = 12;
+		const float pi = glm::pi<float>();
+		float scale = 1.0f / (glm::cos(pi / segments) * glm::cos(pi / (2 * rings)));
+
+		std::vector<glm::vec3> vertices;
+		std::vector<unsigned int> indices;
+		for (unsigned int y = 0; y <= rings; y++) {
+			float theta = y * pi / rings;
+			for (unsigned int x = 0; x <= segments; x++) {
+				float phi = x * 2.0f * pi / segments;
+				vertices.push_back(scale * glm::vec3(glm::cos(phi) * glm::sin(theta), glm::cos(theta), glm::sin(phi) * glm::sin(theta)));
+			}
+		}
+		for (unsigned int y = 0; y < rings; y++) {
+			for (unsigned int x = 0; x < segments; x++) {
+				unsigned int i0 = y * (segments + 1) + x, i1 = i0 + segments + 1;
+				indices.insert(indices.end(), { i0, i0 + 1, i1, i1, i0 + 1, i1 + 1 });
+			}
+		}
+		sphereIndexCount = (unsigned int)indices.size();
+		createIndexedMesh(sphereVAO, sphereVBO, sphereEBO, vertices, indices);
+	}
+	GLState::bindVertexArray(sphereVAO);
+	glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+}
+
+// renderCone() renders a closed cone with its apex at the origin, opening along -z to a base of radius 1 at z = -1.
+// Used as a spot light volume, the base polygon encloses the unit circle.
+// -------------------------------------------------
+void RenderPass::RenderCone()
+{
+	if (coneVAO == 0)
+	{
+		const unsigned int segments = 16;
+		const float pi = glm::pi<float>();
+		float scale = 1.0f / glm::cos(pi / segments);
+
+		std::vector<glm::vec3> vertices = { glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+		std::vector<unsigned int> indices;
+		for (unsigned int x = 0; x < segments; x++) {
+			float phi = x * 2.0f * pi / segments;
+			vertices.push_back(glm::vec3(scale * glm::cos(phi), scale * glm::sin(phi), -1.0f));
+		}
+		for (unsigned int x = 0; x < segments; x++) {
+			unsigned int i0 = 2 + x, i1 = 2 + (x + 1) % segments;
+			indices.insert(indices.end(), { 0, i0, i1, 1, i1, i0 });
+		}
+		coneIndexCount = (unsigned int)indices.size();
+		createIndexedMesh(coneVAO, coneVBO, coneEBO, vertices, indices);
+	}
+	GLState::bindVertexArray(coneVAO);
+	glDrawElements(GL_TRIANGLES, coneIndexCount, GL_UNSIGNED_INT, 0);
+}
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <random>
 
 #include "shader.h"
+#include "rendergraph.h"
 
 
 
@@ -19,13 +20,21 @@ public:
 	virtual ~RenderPass() {};
 	virtual void Render() = 0;
 	virtual void ResizeBuffers(unsigned int width, unsigned int height) = 0;
+	// declares the textures of the pass, called by the render graph whenever it is rebuilt
+	virtual void Setup(RenderGraph::Builder&) {}
 
 protected:
+	friend class RenderGraph;
 	unsigned int TARGET_WIDTH, TARGET_HEIGHT;
+	RenderGraph* graph = nullptr; // set while the pass is part of a graph
 
 	static unsigned int quadVAO; static unsigned int quadVBO;
 	static unsigned int cubeVAO; static unsigned int cubeVBO;
+	static unsigned int sphereVAO; static unsigned int sphereVBO; static unsigned int sphereEBO; static unsigned int sphereIndexCount;
+	static unsigned int coneVAO; static unsigned int coneVBO; static unsigned int coneEBO; static unsigned int coneIndexCount;
 	static void RenderQuad();
 	static void RenderCube();
+	static void RenderSphere();
+	static void RenderCone();
 };
 #endif
@@ -0,0 +1,50 @@
+#ifndef SAMPLECOUNTER_H
+#define SAMPLECOUNTER_H
+
+#include <glad/glad.h>
+
+// Number of samples that passed the depth test between begin() and end(), measured with GL_SAMPLES_PASSED
+// queries. Like GpuTimer the queries rotate through a ring and are read once available, so counting every frame
+// never stalls the CPU. Only one counter can be active at a time.
+class SampleCounter {
+private:
+	static const unsigned int QUERY_COUNT = 4;
+	unsigned int queries[QUERY_COUNT];
+	bool pending[QUERY_COUNT] = {};
+	unsigned int current = 0;
+
+public:
+	// most recent result, a few frames old
+	GLuint64 lastCount = 0;
+
+	SampleCounter() { glGenQueries(QUERY_COUNT, queries); }
+	~SampleCounter() { glDeleteQueries(QUERY_COUNT, queries); }
+	SampleCounter(const SampleCounter&) = delete;
+	SampleCounter& operator=(const SampleCounter&) = delete;
+
+	void begin() {
+		if (pending[current]) {
+			glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &lastCount);
+			pending[current] = false;
+		}
+		glBeginQuery(GL_SAMPLES_PASSED, queries[current]);
+	}
+
+	void end() {
+		glEndQuery(GL_SAMPLES_PASSED);
+		pending[current] = true;
+		current = (current + 1) % QUERY_COUNT;
+
+		// collect every finished query, oldest first
+		for (unsigned int i = 0; i < QUERY_COUNT; i++) {
+			unsigned int index = (current + i) % QUERY_COUNT;
+			if (!pending[index]) continue;
+			GLint available = 0;
+			glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) break;
+			glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &lastCount);
+			pending[index] = false;
+		}
+	}
+};
+#endif
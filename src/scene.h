@@ -4,52 +4,79 @@
 #include <glad/glad.h>
 
 #include <memory>
+#include <random>
 #include <vector>
 
 #include <imgui/imgui.h>
 #include "entity.h"
 #include "light.h"
+#include "lightmanager.h"
 #include "model.h"
 
-struct SceneLights {
-	PointLight pointLights[1];
-	DirLight dirLights[1];
-	SpotLight spotLights[1];
-};
-
 class Scene {
 	enum LoadSuccess {
 		waiting, failed, successful
 	};
 
 private:
-	size_t node_clicked = -1;
-	Entity* selected_entity;
+	EntityHandle node_clicked;
+	Entity selected_entity;
 	char model_file_path[128] = "models/bat.glb";
 	LoadSuccess load_success = waiting;
 public:
-	std::unique_ptr<Entity> root;
-	SceneLights lights;
+	TransformHierarchy transforms;
+	EntityRegistry entities{ &transforms };
+	Entity root;
+	LightManager lights;
 	std::vector<unsigned int> shadowPointLights;
 	std::vector<unsigned int> shadowDirLights;
 	std::vector<unsigned int> shadowSpotLights;
 
 	Scene() {
-		root = std::make_unique<Entity>();
-		strncpy_s(root->name, "root", 128);
-		node_clicked = root->id;
-		selected_entity = root.get();
+		root = Entity(&entities, entities.create(EntityHandle(), "root"));
+		node_clicked = root.handle;
+		selected_entity = root;
+	}
+
+	// scatters lights with random colours over a 20x5x20 box around the origin
+	void addRandomLights(unsigned int count, bool spot) {
+		static std::default_random_engine generator;
+		std::uniform_real_distribution<float> random(0.0f, 1.0f);
+		for (unsigned int i = 0; i < count; i++) {
+			glm::vec4 pos(random(generator) * 20.0f - 10.0f, random(generator) * 5.0f, random(generator) * 20.0f - 10.0f, 1.0f);
+			glm::vec4 color(random(generator), random(generator), random(generator), 1.0f);
+			if (spot) {
+				SpotLight light;
+				light.pos = pos;
+				light.dir = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f);
+				light.color = color;
+				light.cutOff = glm::cos(glm::radians(20.0f));
+				light.outerCutOff = glm::cos(glm::radians(30.0f));
+				light.Linear = 0.7f;
+				light.Quadratic = 1.8f;
+				lights.spotLights.add(light);
+			}
+			else {
+				PointLight light;
+				light.pos = pos;
+				light.color = color;
+				light.Linear = 0.7f;
+				light.Quadratic = 1.8f;
+				lights.pointLights.add(light);
+			}
+		}
 	}
 
 	void renderUI() {
 		ImGui::Begin("Scene##window");
-		if (ImGui::IsItemActive()) { node_clicked = root->id; selected_entity = root.get(); load_success = waiting; }
+		if (!entities.alive(selected_entity.handle)) { node_clicked = root.handle; selected_entity = root; }
+		if (ImGui::IsItemActive()) { node_clicked = root.handle; selected_entity = root; load_success = waiting; }
 
 		ImGui::InputText("Model file name", model_file_path, IM_ARRAYSIZE(model_file_path));
 		if (ImGui::Button("Add")) {
 			std::shared_ptr<Model> model = Model::loadModel(model_file_path);
 			if (model) {
-				selected_entity->addChild(model_file_path);
+				selected_entity.addChild(model_file_path);
 				load_success = successful;
 			}
 			else {
@@ -62,26 +89,16 @@ public:
 		else	ImGui::Spacing();
 
 		ImGui::SeparatorText("Scene##header");
-		for (auto& child : root->children)
-			child->renderUI(node_clicked, selected_entity);
+		for (auto& child : root.children())
+			child.renderUI(node_clicked, selected_entity);
 
 		// Lights UI
-		int index;
-
-		ImGui::SeparatorText("Point lights");
-		index = 0;
-		for (auto& pointLight : lights.pointLights)
-			pointLight.renderUI(++index);
+		ImGui::SeparatorText("Light stress test");
+		if (ImGui::Button("Add 100 point lights")) addRandomLights(100, false);
+		ImGui::SameLine();
+		if (ImGui::Button("Add 100 spot lights")) addRandomLights(100, true);
 
-		ImGui::SeparatorText("Directional lights");
-		index = 0;
-		for (auto& dirLight : lights.dirLights)
-			dirLight.renderUI(++index);
-		
-		ImGui::SeparatorText("Spot lights");
-		index = 0;
-		for (auto& spotLight : lights.spotLights)
-			spotLight.renderUI(++index);
+		lights.renderUI();
 
 		ImGui::End();
 	}
@@ -8,142 +8,82 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+#include "glstate.h"
+#include "programcache.h"
+#include "shadercompiler.h"
+#include "shadersources.h"
 
 class Shader
 {
 public:
-    unsigned int ID;
-    Shader(const char* vertexPath, const char* fragmentPath)
-    {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+    // location of a uniform of type T, resolved once so per-draw uniforms skip the name lookup
+    template<typename T>
+    struct Uniform
+    {
+        GLint location = -1;
+    };
 
+    unsigned int ID;
+    // defines are "NAME" or "NAME value" lines, added after #version. An async shader returns as soon as its compile and
+    // link are submitted, it must not be used before ready(), see ShaderCompiler.
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = {}, bool async = false)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        // 1. retrieve the vertex/fragment source code, with includes resolved and the defines added
+        std::vector<std::vector<std::string>> files(2);
+        std::string vertexCode = preprocess(vertexPath, defines, files[0]);
+        std::string fragmentCode = preprocess(fragmentPath, defines, files[1]);
+        // 2. load the linked program from the cache or compile it
+        build({ { GL_VERTEX_SHADER, vertexCode }, { GL_FRAGMENT_SHADER, fragmentCode } }, files, start, async);
     }
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath)
-    {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string geometryCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream gShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            gShaderFile.open(geometryPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, gShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            gShaderStream << gShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            gShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            geometryCode = gShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
+    Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath, const std::vector<std::string>& defines = {}, bool async = false)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        // 1. retrieve the vertex/geometry/fragment source code, with includes resolved and the defines added
+        std::vector<std::vector<std::string>> files(3);
+        std::string vertexCode = preprocess(vertexPath, defines, files[0]);
+        std::string geometryCode = preprocess(geometryPath, defines, files[1]);
+        std::string fragmentCode = preprocess(fragmentPath, defines, files[2]);
+        // 2. load the linked program from the cache or compile it
+        build({ { GL_VERTEX_SHADER, vertexCode }, { GL_GEOMETRY_SHADER, geometryCode }, { GL_FRAGMENT_SHADER, fragmentCode } }, files, start, async);
+    }
+    ~Shader()
+    {
+        if (!ready())
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            ShaderCompiler::cancel(this);
+            for (auto& shader : pendingShaders)
+                glDeleteShader(shader.second);
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* gShaderCode = geometryCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, geometry, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // geometry shader
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        checkCompileErrors(geometry, "GEOMETRY");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, geometry);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(geometry);
-        glDeleteShader(fragment);
+    }
+    bool ready() const
+    {
+        return pendingShaders.empty();
+    }
+    // checks the results of a submitted compile and link, blocks if the driver is not done yet
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        if (ready())
+            return;
+        auto start = std::chrono::high_resolution_clock::now();
+        ShaderCompiler::cancel(this);
+        complete();
+        ShaderCompiler::finished++;
+        ShaderCompiler::finishTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        GLState::useProgram(ID);
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -152,69 +92,313 @@ public:
         unsigned int uniformBlockIndex = glGetUniformBlockIndex(ID, uniformBlockName);
         glUniformBlockBinding(ID, uniformBlockIndex, uniformBlockBinding);
     }
+    // location of a uniform or array element ("samples[3]"), -1 when the program has no such uniform
+    // ------------------------------------------------------------------------
+    GLint location(const std::string& name) const
+    {
+        auto it = locations.find(name);
+        return it == locations.end() ? -1 : it->second;
+    }
+    template<typename T>
+    Uniform<T> uniform(const std::string& name) const
+    {
+        return { location(name) };
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(location(name), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(location(name), 1, &value[0]);
     }
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(location(name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(location(name), 1, &value[0]);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(location(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(location(name), 1, &value[0]);
     }
     void setVec4(const std::string& name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(location(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+    // typed handles, for uniforms set per draw
+    // ------------------------------------------------------------------------
+    void set(Uniform<bool> uniform, bool value) const
+    {
+        glUniform1i(uniform.location, (int)value);
+    }
+    void set(Uniform<int> uniform, int value) const
+    {
+        glUniform1i(uniform.location, value);
+    }
+    void set(Uniform<float> uniform, float value) const
+    {
+        glUniform1f(uniform.location, value);
+    }
+    void set(Uniform<glm::vec2> uniform, const glm::vec2& value) const
+    {
+        glUniform2fv(uniform.location, 1, &value[0]);
+    }
+    void set(Uniform<glm::vec3> uniform, const glm::vec3& value) const
+    {
+        glUniform3fv(uniform.location, 1, &value[0]);
+    }
+    void set(Uniform<glm::vec4> uniform, const glm::vec4& value) const
+    {
+        glUniform4fv(uniform.location, 1, &value[0]);
+    }
+    void set(Uniform<glm::mat3> uniform, const glm::mat3& mat) const
+    {
+        glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void set(Uniform<glm::mat4> uniform, const glm::mat4& mat, GLsizei count = 1) const
+    {
+        glUniformMatrix4fv(uniform.location, count, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    uint64_t key = 0;
+    std::vector<std::pair<GLenum, unsigned int>> pendingShaders; // stage and shader object, until complete()
+    std::vector<std::vector<std::string>> files;
+    std::unordered_map<std::string, GLint> locations;
+
+    // the program binary cache first, a source compile when it has no binary or the driver rejects it
+    // ------------------------------------------------------------------------
+    void build(const std::vector<std::pair<GLenum, std::string>>& stages, const std::vector<std::vector<std::string>>& files, std::chrono::high_resolution_clock::time_point start, bool async)
+    {
+        key = ProgramCache::key(stages);
+        ID = ProgramCache::load(key);
+        bool cached = ID != 0;
+        if (cached)
+            introspect();
+        else
+        {
+            // no status is queried until complete(), the driver may still be compiling when this returns
+            for (auto& stage : stages)
+            {
+                const char* code = stage.second.c_str();
+                unsigned int shader = glCreateShader(stage.first);
+                glShaderSource(shader, 1, &code, NULL);
+                glCompileShader(shader);
+                pendingShaders.push_back({ stage.first, shader });
+            }
+            // shader Program
+            ID = glCreateProgram();
+            for (auto& shader : pendingShaders)
+                glAttachShader(ID, shader.second);
+            ProgramCache::prepare(ID);
+            glLinkProgram(ID);
+            this->files = files;
+            if (async)
+                ShaderCompiler::submit(this);
+            else
+                complete();
+        }
+        float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        (cached ? ProgramCache::loaded : ProgramCache::compiled)++;
+        (cached ? ProgramCache::loadTime : ProgramCache::compileTime) += time;
+    }
+    // reports compile and link errors and stores the linked program in the cache
+    // ------------------------------------------------------------------------
+    void complete()
+    {
+        for (unsigned int i = 0; i < pendingShaders.size(); i++)
+        {
+            GLenum stage = pendingShaders[i].first;
+            if (!checkCompileErrors(pendingShaders[i].second, stage == GL_VERTEX_SHADER ? "VERTEX" : stage == GL_GEOMETRY_SHADER ? "GEOMETRY" : "FRAGMENT"))
+            {
+                // error locations are (source string)(line), the source strings are the files set by #line
+                for (unsigned int f = 0; f < files[i].size(); f++)
+                    std::cout << f << ": " << files[i][f] << std::endl;
+            }
+        }
+        GLint success = checkCompileErrors(ID, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessary
+        for (auto& shader : pendingShaders)
+            glDeleteShader(shader.second);
+        pendingShaders.clear();
+        files.clear();
+        if (success)
+        {
+            introspect();
+            ProgramCache::store(key, ID);
+        }
+    }
+    // the locations of all active uniforms, queried once after linking. Uniforms in blocks have none and are
+    // skipped, every element of an array gets its own entry.
+    // ------------------------------------------------------------------------
+    void introspect()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            if (location < 0)
+                continue;
+            locations[name] = location;
+            // arrays are reported as "name[0]"
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                locations[base] = location;
+                for (GLint e = 1; e < size; e++)
+                {
+                    std::string element = base + "[" + std::to_string(e) + "]";
+                    locations[element] = glGetUniformLocation(ID, element.c_str());
+                }
+            }
+        }
+    }
+    // sources are compiled into the executable by tools/embed_shaders.py, loose files are only read for shaders that
+    // are not embedded, or first with SHADERS_FROM_DISK defined so shaders can be edited without a rebuild
+    // ------------------------------------------------------------------------
+    static bool readSource(const std::string& path, std::string& code)
+    {
+#ifndef SHADERS_FROM_DISK
+        if (const char* embedded = embeddedShaderSource(path))
+        {
+            code = embedded;
+            return true;
+        }
+#endif
+        std::ifstream file(path);
+        if (file)
+        {
+            std::stringstream stream;
+            stream << file.rdbuf();
+            code = stream.str();
+            return true;
+        }
+#ifdef SHADERS_FROM_DISK
+        if (const char* embedded = embeddedShaderSource(path))
+        {
+            code = embedded;
+            return true;
+        }
+#endif
+        return false;
+    }
+    // the source of one stage: includes resolved, then the defines after the #version line. files gets the file of
+    // every #line source string number.
+    // ------------------------------------------------------------------------
+    static std::string preprocess(const std::string& path, const std::vector<std::string>& defines, std::vector<std::string>& files)
+    {
+        std::string code;
+        if (!readSource(path, code))
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return code;
+        }
+        std::vector<std::string> included;
+        code = resolveIncludes(code, path, files, included);
+
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (lineEnd != std::string::npos && !defines.empty())
+        {
+            std::string block;
+            for (auto& define : defines)
+                block += "#define " + define + "\n";
+            code.insert(lineEnd + 1, block + "#line 2 0\n");
+        }
+        return code;
+    }
+    // replaces #include "file" lines with the contents of file, relative to the including file. GLSL has no
+    // includes of its own, this is how shaders share helpers such as gbuffer.glsl. Every file is included once per
+    // stage, #line directives keep compile errors pointing at the right file and line.
+    // ------------------------------------------------------------------------
+    static std::string resolveIncludes(const std::string& code, const std::string& path, std::vector<std::string>& files, std::vector<std::string>& included)
+    {
+        std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        unsigned int fileIndex = (unsigned int)files.size();
+        files.push_back(path);
+        included.push_back(path);
+        std::stringstream in(code), out;
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(in, line))
+        {
+            lineNumber++;
+            size_t start = line.find("#include \"");
+            size_t end = start == std::string::npos ? start : line.find('"', start + 10);
+            if (start != std::string::npos && line.find_first_not_of(" \t") == start && end != std::string::npos)
+            {
+                std::string includePath = directory + line.substr(start + 10, end - start - 10);
+                if (std::find(included.begin(), included.end(), includePath) != included.end())
+                {
+                    out << "\n";
+                    continue;
+                }
+                std::string includeCode;
+                if (!readSource(includePath, includeCode))
+                {
+                    std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << includePath << std::endl;
+                    out << "\n";
+                    continue;
+                }
+                out << "#line 1 " << files.size() << "\n";
+                out << resolveIncludes(includeCode, includePath, files, included);
+                out << "#line " << lineNumber + 1 << " " << fileIndex << "\n";
+            }
+            else
+            {
+                out << line << "\n";
+            }
+        }
+        return out.str();
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    GLint checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -236,6 +420,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
@@ -0,0 +1,73 @@
+#include "shadercompiler.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+unsigned int ShaderCompiler::finished = 0;
+float ShaderCompiler::finishTime = 0.0f;
+std::vector<Shader*> ShaderCompiler::queue;
+bool ShaderCompiler::parallelCompile = false;
+
+void ShaderCompiler::init(GLADloadproc load)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	const char* extension = nullptr;
+	for (GLint i = 0; i < count && !extension; i++) {
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (name && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+			extension = name;
+	}
+	if (!extension) {
+		std::cout << "Parallel shader compile not supported, new programs are finished one per frame" << std::endl;
+		return;
+	}
+
+	// the ARB entry point has the same signature and enums
+	auto maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+	if (!maxThreads) maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+	if (maxThreads) maxThreads(0xFFFFFFFF); // as many threads as the driver likes
+	parallelCompile = true;
+}
+
+void ShaderCompiler::submit(Shader* shader)
+{
+	queue.push_back(shader);
+}
+
+void ShaderCompiler::cancel(Shader* shader)
+{
+	queue.erase(std::remove(queue.begin(), queue.end(), shader), queue.end());
+}
+
+void ShaderCompiler::poll()
+{
+	if (!parallelCompile) {
+		if (!queue.empty()) {
+			Shader* shader = queue.front();
+			queue.erase(queue.begin());
+			shader->finish();
+		}
+		return;
+	}
+
+	for (unsigned int i = 0; i < queue.size();) {
+		GLint done = GL_FALSE;
+		glGetProgramiv(queue[i]->ID, GL_COMPLETION_STATUS_KHR, &done);
+		if (done) {
+			Shader* shader = queue[i];
+			queue.erase(queue.begin() + i);
+			shader->finish();
+		}
+		else {
+			i++;
+		}
+	}
+}
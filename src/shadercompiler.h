@@ -0,0 +1,40 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+class Shader;
+
+// Queue of programs whose compile and link were submitted without waiting for the result. Querying
+// GL_COMPILE_STATUS or GL_LINK_STATUS right after glLinkProgram blocks until the driver is done. With
+// KHR_parallel_shader_compile (or the ARB version) the driver compiles on its own threads and GL_COMPLETION_STATUS_KHR
+// tells without blocking whether a program is done, so poll() only finishes programs that are ready. Without the
+// extension poll() finishes one program per frame, which still blocks but spreads the stalls over several frames.
+// The extension is not part of the generated glad loader, init() loads glMaxShaderCompilerThreadsKHR itself.
+class ShaderCompiler {
+public:
+	// stats since startup
+	static unsigned int finished;
+	static float finishTime; // ms spent in finish(), on the render thread
+
+	// after the context is current
+	static void init(GLADloadproc load);
+	static bool parallel() { return parallelCompile; }
+
+	// shader has submitted its compile and link and must not be used before it is ready
+	static void submit(Shader* shader);
+	// removes a shader that is destroyed before it is finished
+	static void cancel(Shader* shader);
+	// once per frame, finishes the shaders the driver is done with
+	static void poll();
+	static size_t pending() { return queue.size(); }
+
+private:
+	static std::vector<Shader*> queue;
+	static bool parallelCompile;
+};
+
+#endif
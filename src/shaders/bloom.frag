@@ -6,7 +6,11 @@ in vec2 TexCoords;
 uniform sampler2D image;
 
 uniform bool horizontal;
-uniform float weights[5] = float[] (0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+
+// see BloomBlock
+layout (std140) uniform BloomParams{
+    float weights[5];
+};
 
 void main(){
     vec2 tex_offset = 1.0 / textureSize(image, 0);
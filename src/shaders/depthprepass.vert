@@ -0,0 +1,15 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+};
+#include "object.glsl"
+
+// must compute gl_Position exactly like gbuffer.vert
+invariant gl_Position;
+
+void main(){
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -1,5 +1,5 @@
 #version 410 core
 
+// depth only, leaving gl_FragDepth alone keeps early depth testing
 void main(){
-	gl_FragDepth = gl_FragCoord.z;
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#version 410 core
+layout (location = 0) out vec4 Moments;
+
+in vec2 TexCoords;
+
+// exponential variance shadow map prefilter, see ShadowMapPass
+uniform sampler2DArray depthMap; // read without comparison
+uniform sampler2D moments;       // result of the horizontal pass
+uniform int layer;
+uniform bool horizontal;
+uniform int radius;
+uniform vec2 exponents; // positive and negative warp
+
+// both exponential warps of a [0, 1] depth with their squares, must match glighting.frag
+vec4 warp(float depth){
+    depth = 2.0 * depth - 1.0;
+    float pos = exp(exponents.x * depth);
+    float neg = -exp(-exponents.y * depth);
+    return vec4(pos, pos * pos, neg, neg * neg);
+}
+
+vec4 tap(vec2 offset){
+    if(horizontal)
+        return warp(texture(depthMap, vec3(TexCoords + offset, layer)).r);
+    return texture(moments, TexCoords + offset);
+}
+
+void main(){
+    vec2 texelSize = 1.0 / vec2(textureSize(depthMap, 0).xy);
+    vec2 direction = horizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+
+    // separable gaussian, unlike depth the moments can be filtered before the shadow test
+    float sigma = 0.5 * float(radius) + 0.5;
+    vec4 result = vec4(0.0);
+    float weightSum = 0.0;
+    for(int i = -radius; i <= radius; i++){
+        float weight = exp(-float(i * i) / (2.0 * sigma * sigma));
+        result += tap(direction * float(i)) * weight;
+        weightSum += weight;
+    }
+    Moments = result / weightSum;
+}
@@ -1,28 +1,33 @@
 #version 410 core
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec4 gAlbedoSpec;
+// position comes from the depth buffer, see gbuffer.glsl
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
 
-in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 in mat3 TBN;
 
 uniform sampler2D texture_diffuse;
 uniform sampler2D texture_specular;
+#ifdef NORMAL_MAP
 uniform sampler2D normal_map;
+#endif
+
+#include "octahedral.glsl"
 
 void main()
 {    
-    // store the fragment position vector in the first gbuffer texture
-    gPosition = FragPos;
-    // also store the per-fragment normals into the gbuffer
+    // store the per-fragment normals into the gbuffer
+#ifdef NORMAL_MAP
     vec3 tangentNormal = normalize(texture(normal_map, TexCoords).rgb * 2.0 - 1.0);
     if(dot(tangentNormal, vec3(1.0)) == 0.0){
-        gNormal = TBN[2];
+        gNormal = encodeNormal(TBN[2]);
     } else {
-        gNormal = TBN * tangentNormal;
+        gNormal = encodeNormal(TBN * tangentNormal);
     }
+#else
+    gNormal = encodeNormal(TBN[2]);
+#endif
     // and the diffuse per-fragment color
     gAlbedoSpec.rgb = texture(texture_diffuse, TexCoords).rgb;
     // store specular intensity in gAlbedoSpec's alpha component
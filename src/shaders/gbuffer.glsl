@@ -0,0 +1,29 @@
+// G-buffer layout and decoding, shared by every pass that reads the G-buffer, see GBufferPass.
+//   gDepth       24 bit depth, view space position is reconstructed with the inverse projection
+//   gNormal      RG16, octahedral encoded view space normal
+//   gAlbedoSpec  RGBA8, albedo and specular intensity
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+    mat4 inverseProjection;
+};
+
+#include "octahedral.glsl"
+
+vec3 viewPositionFromDepth(vec2 uv, float depth){
+    vec4 pos = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return pos.xyz / pos.w;
+}
+
+vec3 gBufferPosition(vec2 uv){
+    return viewPositionFromDepth(uv, texture(gDepth, uv).r);
+}
+
+vec3 gBufferNormal(vec2 uv){
+    return decodeNormal(texture(gNormal, uv).rg);
+}
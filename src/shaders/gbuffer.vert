@@ -6,25 +6,26 @@ layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
 
 
-out vec3 FragPos;
 out vec2 TexCoords;
 out mat3 TBN;
 
+// bit-identical to depthprepass.vert, the G-buffer is drawn with GL_EQUAL after the depth prepass
+invariant gl_Position;
+
 layout (std140) uniform Matrices{
     mat4 projection;
     mat4 view;
 };
-uniform mat4 model;
+#include "object.glsl"
 
 void main(){
 	gl_Position = projection * view * model * vec4(aPos, 1.0);
 
-	FragPos = vec3(view * model * vec4(aPos, 1.0));
-	
-	mat3 normalMatrix =  transpose(inverse(mat3(view * model)));
-	vec3 Normal = normalize(normalMatrix * aNormal);
-	vec3 Tangent = normalize(normalMatrix * aTangent);
-	vec3 Bitangent = normalize(normalMatrix * aBitangent);
+	// view is a rigid transform, so its rotation part is its own inverse transpose
+	mat3 viewNormalMatrix = mat3(view) * normalMatrix;
+	vec3 Normal = normalize(viewNormalMatrix * aNormal);
+	vec3 Tangent = normalize(viewNormalMatrix * aTangent);
+	vec3 Bitangent = normalize(viewNormalMatrix * aBitangent);
 	TBN = mat3(Tangent, Bitangent, Normal); //tangent space to world space
 
 	TexCoords = aTexCoords;
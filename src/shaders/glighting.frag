@@ -4,81 +4,176 @@ layout (location = 1) out vec4 BrightColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
-uniform sampler2D gAlbedoSpec;
+#include "gbuffer.glsl"
 
+// variants: SSAO, SSR and CLUSTERED (off when point and spot lights are drawn as light volumes). MAX_DIR_LIGHTS,
+// CLUSTER_X/Y/Z, SPOT_LIGHT_BIT, MAX_CASCADES, POINT_SHADOW_TIERS and SHADOW_LAYER_BITS come from the C++ side.
+#ifdef SSAO
 uniform sampler2D ssao;
+#endif
+#ifdef SSR
 uniform sampler2D ssr;
-uniform bool ssaoOn;
-uniform bool ssrOn;
-
-layout (std140) uniform Matrices{
-    mat4 projection;
-    mat4 view;
-};
-
-struct PointLight {
-	vec4 pos, color;
-	float Linear, Quadratic, pad1, pad2;
-};
+#endif
 
 struct DirLight {
 	vec4 dir, color;
 };
 
-struct SpotLight {
-	vec4 pos, dir, color;
-	float cutOff, outerCutOff, Linear, Quadratic;
+layout (std140) uniform Lights{
+	DirLight dirLights[MAX_DIR_LIGHTS];
+	int dirLightCount;
 };
 
-#define NR_POINT_LIGHTS 1
-#define NR_DIR_LIGHTS 1
-#define NR_SPOT_LIGHTS 1
-
-layout (std140) uniform Lights{
-	PointLight pointLights[NR_POINT_LIGHTS];
-	DirLight dirLights[NR_DIR_LIGHTS];
-	SpotLight spotLights[NR_SPOT_LIGHTS];
+// clustered point and spot lights, see LightClusters
+
+uniform samplerBuffer pointLightData; // PointLight structs, 3 texels each, shadow slot in the w of the last
+uniform samplerBuffer spotLightData;  // SpotLight structs, 5 texels each
+uniform usamplerBuffer clusterData;   // offset and count into lightIndices
+uniform usamplerBuffer lightIndices;  // spot lights are tagged with SPOT_LIGHT_BIT
+uniform float sliceScale;
+uniform float sliceBias;
+uniform vec2 screenSize;
+
+// cascaded shadow maps of the first directional light, see ShadowMapPass
+layout (std140) uniform Shadows{
+    mat4 viewToShadow[MAX_CASCADES];
+    vec4 cascadeSplits; // view space far distance of each cascade
+    vec4 texelSizes;    // world space size of a shadow map texel per cascade
+    int cascadeCount;   // 0 when shadows are off
+    int shadowFilter;
+    float evsmPositive, evsmNegative; // exponents of the warps
+    float evsmBleedReduction;
 };
 
+#define FILTER_PCF 0
+#define FILTER_EVSM 1
+
+uniform sampler2DArrayShadow shadowMap;
+uniform sampler2DArray shadowMoments; // EVSM only
+
+#include "pointshadows.glsl"
+
+// upper bound of the fraction of the filter region that is lit, from the mean and variance of its depths
+float chebyshev(vec2 moments, float depth, float minVariance){
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    // the bound is loose where occluders overlap, cutting off its tail hides the light bleeding
+    pMax = clamp((pMax - evsmBleedReduction) / (1.0 - evsmBleedReduction), 0.0, 1.0);
+    return depth <= moments.x ? 1.0 : pMax;
+}
+
+float dirShadow(vec3 fragPos, vec3 normal){
+    float depth = -fragPos.z;
+    int cascade = 0;
+    while(cascade < cascadeCount - 1 && depth > cascadeSplits[cascade])
+        cascade++;
+    if(cascadeCount == 0 || depth > cascadeSplits[cascade])
+        return 1.0;
+
+    // offset along the normal by about a texel against acne on surfaces at grazing angles
+    vec3 shadowPos = vec3(viewToShadow[cascade] * vec4(fragPos + normal * texelSizes[cascade] * 1.5, 1.0));
+
+    if(shadowFilter == FILTER_EVSM){
+        if(any(lessThan(shadowPos.xy, vec2(0.0))) || any(greaterThan(shadowPos.xy, vec2(1.0))))
+            return 1.0;
+        // mip level from the size of a screen pixel in shadow map texels. Derivatives are no use here,
+        // the cascade changes between neighbouring pixels.
+        float pixelSize = depth * 2.0 / (projection[1][1] * screenSize.y);
+        float lod = log2(max(pixelSize / texelSizes[cascade], 1.0));
+        vec4 moments = textureLod(shadowMoments, vec3(shadowPos.xy, cascade), lod);
+
+        float warped = 2.0 * shadowPos.z - 1.0;
+        float pos = exp(evsmPositive * warped);
+        float neg = -exp(-evsmNegative * warped);
+        // minimum variance scaled with the slope of each warp, against acne
+        vec2 depthScale = 0.0001 * vec2(evsmPositive, evsmNegative) * vec2(pos, neg);
+        vec2 minVariance = depthScale * depthScale;
+        return min(chebyshev(moments.xy, pos, minVariance.x), chebyshev(moments.zw, neg, minVariance.y));
+    }
+
+    // 5x5 PCF, each tap is bilinearly filtered by the hardware comparison
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for(int x = -2; x <= 2; x++)
+        for(int y = -2; y <= 2; y++)
+            lit += texture(shadowMap, vec4(shadowPos.xy + vec2(x, y) * texelSize, cascade, shadowPos.z));
+    return lit / 25.0;
+}
+
 
 void main(){
-    vec3 FragPos = texture(gPosition, TexCoords).xyz;
-    vec3 Normal = texture(gNormal, TexCoords).xyz;
+    vec3 FragPos = gBufferPosition(TexCoords);
+    vec3 Normal = gBufferNormal(TexCoords);
     vec3 Albedo = texture(gAlbedoSpec, TexCoords).rgb;
     float Specular = texture(gAlbedoSpec, TexCoords).a;
     
     vec3 viewDir = normalize(-FragPos);
 
     // ambient
-    vec3 ambient;
-    if(ssaoOn){
-        float AmbientOcclusion = texture(ssao, TexCoords).r;
-        ambient = 0.1 * AmbientOcclusion * Albedo;
-    } else {
-        ambient = 0.1 * Albedo;
-    }
+#ifdef SSAO
+    float AmbientOcclusion = texture(ssao, TexCoords).r;
+    vec3 ambient = 0.1 * AmbientOcclusion * Albedo;
+#else
+    vec3 ambient = 0.1 * Albedo;
+#endif
 
     vec3 lighting = ambient;
 
-    for(int i = 0; i < NR_POINT_LIGHTS; i++){
-        vec3 lightPos = vec3(view * pointLights[i].pos);
+#ifdef CLUSTERED
+    // cluster of this pixel
+    ivec2 tile = ivec2(gl_FragCoord.xy / screenSize * vec2(CLUSTER_X, CLUSTER_Y));
+    int slice = clamp(int(log(max(-FragPos.z, 1e-4)) * sliceScale + sliceBias), 0, CLUSTER_Z - 1);
+    uvec2 cluster = texelFetch(clusterData, (slice * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x).rg;
+
+    for(uint i = 0u; i < cluster.y; i++){
+        uint entry = texelFetch(lightIndices, int(cluster.x + i)).r;
+        bool spot = (entry & SPOT_LIGHT_BIT) != 0u;
+        int light = int(entry & ~SPOT_LIGHT_BIT);
+
+        vec3 lightPos, lightColor, spotDir;
+        float Linear, Quadratic, range, cutOff, outerCutOff, shadowSlot = -1.0;
+        if(spot){
+            vec4 params = texelFetch(spotLightData, 5 * light + 3);
+            lightPos = texelFetch(spotLightData, 5 * light).xyz;
+            spotDir = texelFetch(spotLightData, 5 * light + 1).xyz;
+            lightColor = texelFetch(spotLightData, 5 * light + 2).rgb;
+            cutOff = params.x; outerCutOff = params.y; Linear = params.z; Quadratic = params.w;
+            range = texelFetch(spotLightData, 5 * light + 4).x;
+        } else {
+            vec4 params = texelFetch(pointLightData, 3 * light + 2);
+            lightPos = texelFetch(pointLightData, 3 * light).xyz;
+            lightColor = texelFetch(pointLightData, 3 * light + 1).rgb;
+            Linear = params.x; Quadratic = params.y; range = params.z; shadowSlot = params.w;
+        }
+
+        lightPos = vec3(view * vec4(lightPos, 1.0));
         vec3 lightDir = normalize(lightPos - FragPos);
-        
+        float dist = length(lightPos - FragPos);
+        if(dist > range)
+            continue;
+
+        float intensity = pointShadow(shadowSlot, FragPos + Normal * 0.02 - lightPos, range);
+        if(spot){
+            // spot light cone
+            float theta = dot(normalize(vec3(view * vec4(spotDir, 0.0))), -lightDir);
+            float epsilon = cutOff - outerCutOff;
+            intensity *= clamp((theta - outerCutOff) / epsilon, 0.0, 1.0);
+        }
+
         // diffuse
         float diff = max(dot(Normal, lightDir), 0.0);
         // specular
         vec3 halfwayDir = normalize(lightDir + viewDir);  
         float spec = pow(max(dot(Normal, halfwayDir), 0.0), 32.0) * Specular;
         // attenuation
-        float dist = length(lightPos - FragPos);
-        float attenuation = 1.0 / (1.0 + pointLights[i].Linear * dist + pointLights[i].Quadratic * dist * dist);
+        float attenuation = 1.0 / (1.0 + Linear * dist + Quadratic * dist * dist);
         // result
-        lighting += attenuation * (diff + spec) * Albedo * vec3(dirLights[i].color);
+        lighting += intensity * attenuation * (diff + spec) * Albedo * lightColor;
     }
+#endif
 
-    for(int i = 0; i < NR_DIR_LIGHTS; i++){
+    for(int i = 0; i < dirLightCount; i++){
         vec3 lightDir = vec3(view * dirLights[i].dir);
         // diffuse
         float diff = max(dot(Normal, -lightDir), 0.0);
@@ -86,33 +181,16 @@ void main(){
         vec3 halfwayDir = normalize(-lightDir + viewDir);  
         float spec = pow(max(dot(Normal, halfwayDir), 0.0), 32.0) * Specular;
         // result
-        lighting += (diff + spec) * Albedo * vec3(dirLights[i].color);
+        float shadow = i == 0 ? dirShadow(FragPos, Normal) : 1.0;
+        lighting += shadow * (diff + spec) * Albedo * vec3(dirLights[i].color);
     }
 
-    for(int i = 0; i < NR_SPOT_LIGHTS; i++){
-        vec3 lightDir = vec3(view * spotLights[i].dir);
-        vec3 lightPos = vec3(view * spotLights[i].pos);
-        
-        float theta = dot(lightDir, normalize(FragPos - lightPos));
-        float epsilon = spotLights[i].cutOff - spotLights[i].outerCutOff;
-        float intensity = clamp((theta - spotLights[i].outerCutOff) / epsilon, 0.0, 1.0);
-        if(theta > spotLights[i].cutOff){
-            // diffuse
-            float diff = max(dot(Normal, vec3(-lightDir)), 0.0);
-            // specular
-            vec3 halfwayDir = normalize(vec3(-lightDir) + viewDir);  
-            float spec = pow(max(dot(Normal, halfwayDir), 0.0), 32.0) * Specular;
-            // result
-            lighting += intensity * (diff + spec) * Albedo * vec3(spotLights[i].color);
-        }
-    }
-
-    if(ssrOn){
-        vec2 reflectionUV = texture(ssr, TexCoords).xy;
-        float reflectionVis = texture(ssr, TexCoords).z;
-        vec3 reflectionColor = texture(gAlbedoSpec, reflectionUV).rgb;
-        lighting += reflectionColor * reflectionVis * Specular;
-    }
+#ifdef SSR
+    vec2 reflectionUV = texture(ssr, TexCoords).xy;
+    float reflectionVis = texture(ssr, TexCoords).z;
+    vec3 reflectionColor = texture(gAlbedoSpec, reflectionUV).rgb;
+    lighting += reflectionColor * reflectionVis * Specular;
+#endif
 
     FragColor = vec4(lighting, 1.0);
 
@@ -3,34 +3,38 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform int hdrMode;
-uniform bool bloomOn;
-uniform float exposure;
+// variants: BLOOM, and TONEMAP_REINHARD or TONEMAP_EXPOSURE (neither writes the HDR color as is)
+// see HDRBlock
+layout (std140) uniform HDRParams{
+    float exposure;
+};
 uniform sampler2D hdrBuffer;
+#ifdef BLOOM
 uniform sampler2D bloom;
+#endif
 
 void main(){
     const float gamma = 2.2;
     vec3 hdrColor = texture(hdrBuffer, TexCoords).rgb;
 
-    if(bloomOn){
-        vec3 bloomColor = texture(bloom, TexCoords).rgb;
-        hdrColor += bloomColor;
-    }
+#ifdef BLOOM
+    vec3 bloomColor = texture(bloom, TexCoords).rgb;
+    hdrColor += bloomColor;
+#endif
 
-    if(hdrMode == 0)
-        FragColor = vec4(hdrColor, 1.0);
-    else if(hdrMode == 1){
-         // reinhard tone mapping
-        vec3 mapped = hdrColor / (hdrColor + vec3(1.0));
-        // gamma correction 
-        mapped = pow(mapped, vec3(1.0 / gamma));
-  
-        FragColor = vec4(mapped, 1.0);
-    } else if(hdrMode == 2){       
-        vec3 mapped = vec3(1.0) - exp(-hdrColor * exposure);
-        mapped = pow(mapped, vec3(1.0 / gamma));
+#if defined(TONEMAP_REINHARD)
+    // reinhard tone mapping
+    vec3 mapped = hdrColor / (hdrColor + vec3(1.0));
+    // gamma correction 
+    mapped = pow(mapped, vec3(1.0 / gamma));
 
-        FragColor = vec4(mapped, 1.0);
-    }
+    FragColor = vec4(mapped, 1.0);
+#elif defined(TONEMAP_EXPOSURE)
+    vec3 mapped = vec3(1.0) - exp(-hdrColor * exposure);
+    mapped = pow(mapped, vec3(1.0 / gamma));
+
+    FragColor = vec4(mapped, 1.0);
+#else
+    FragColor = vec4(hdrColor, 1.0);
+#endif
 }
\ No newline at end of file
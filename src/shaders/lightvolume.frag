@@ -0,0 +1,58 @@
+#version 410 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+#include "gbuffer.glsl"
+
+uniform vec2 screenSize;
+
+// a single point or spot light, blended additively over the ambient and directional lighting
+uniform vec3 lightPos;
+uniform vec3 lightDir;
+uniform vec3 lightColor;
+uniform float range;
+uniform float Linear;
+uniform float Quadratic;
+uniform bool spot;
+uniform float cutOff;
+uniform float outerCutOff;
+uniform float shadowSlot; // point lights only, see PointShadowPass
+
+#include "pointshadows.glsl"
+
+void main(){
+    vec2 TexCoords = gl_FragCoord.xy / screenSize;
+    vec3 FragPos = gBufferPosition(TexCoords);
+    vec3 Normal = gBufferNormal(TexCoords);
+    vec3 Albedo = texture(gAlbedoSpec, TexCoords).rgb;
+    float Specular = texture(gAlbedoSpec, TexCoords).a;
+
+    vec3 viewDir = normalize(-FragPos);
+    vec3 viewLightPos = vec3(view * vec4(lightPos, 1.0));
+    vec3 L = normalize(viewLightPos - FragPos);
+    float dist = length(viewLightPos - FragPos);
+    if(dist > range)
+        discard;
+
+    float intensity = pointShadow(shadowSlot, FragPos + Normal * 0.02 - viewLightPos, range);
+    if(spot){
+        float theta = dot(normalize(vec3(view * vec4(lightDir, 0.0))), -L);
+        float epsilon = cutOff - outerCutOff;
+        intensity *= clamp((theta - outerCutOff) / epsilon, 0.0, 1.0);
+    }
+
+    // diffuse
+    float diff = max(dot(Normal, L), 0.0);
+    // specular
+    vec3 halfwayDir = normalize(L + viewDir);
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 32.0) * Specular;
+    // attenuation
+    float attenuation = 1.0 / (1.0 + Linear * dist + Quadratic * dist * dist);
+    vec3 lighting = intensity * attenuation * (diff + spec) * Albedo * lightColor;
+
+    FragColor = vec4(lighting, 1.0);
+
+    // thresholded per light, so a pixel only blooms when a single light makes it bright
+    float brightness = dot(lighting, vec3(0.2126, 0.7152, 0.0722));
+    BrightColor = vec4(lighting * vec3(brightness > 1.0), 1.0);
+}
@@ -0,0 +1,15 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+    mat4 inverseProjection; // declared by gbuffer.glsl in the fragment stage, the blocks must match
+};
+
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
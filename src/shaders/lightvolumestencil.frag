@@ -0,0 +1,6 @@
+#version 410 core
+
+// only the stencil is written while marking the pixels inside a light volume
+void main()
+{
+}
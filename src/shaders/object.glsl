@@ -0,0 +1,5 @@
+// per-object constants of the render list, see ObjectBlock
+layout (std140) uniform Object{
+    mat4 model;
+    mat3 normalMatrix; // inverse transpose of model, computed on the CPU
+};
@@ -0,0 +1,10 @@
+#version 410 core
+in vec3 FragPos;
+
+uniform vec3 lightPos;
+uniform float range;
+
+// linear distance, the same for every face so the lighting shader does not need the face projection
+void main(){
+	gl_FragDepth = length(FragPos - lightPos) / range;
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+
+#include "object.glsl"
+
+// world space, the geometry shader projects once per cube face
+void main(){
+	gl_Position = model * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+// point light shadows, see PointShadowPass. POINT_SHADOW_TIERS and SHADOW_LAYER_BITS come from the C++ side,
+// the switch below assumes 4 tiers. Needs the view matrix from gbuffer.glsl.
+uniform samplerCubeArrayShadow pointShadowMaps[POINT_SHADOW_TIERS];
+
+// the cube maps store distance / range, lightToFrag is in view space
+float pointShadow(float slot, vec3 lightToFrag, float range){
+    if(slot < 0.0)
+        return 1.0;
+    int s = int(slot);
+    vec4 coord = vec4(transpose(mat3(view)) * lightToFrag, float(s & ((1 << SHADOW_LAYER_BITS) - 1)));
+    float ref = (length(lightToFrag) - 0.05) / range;
+    // sampler arrays may only be indexed with constants here
+    switch(s >> SHADOW_LAYER_BITS){
+        case 0: return texture(pointShadowMaps[0], coord, ref);
+        case 1: return texture(pointShadowMaps[1], coord, ref);
+        case 2: return texture(pointShadowMaps[2], coord, ref);
+        default: return texture(pointShadowMaps[3], coord, ref);
+    }
+}
@@ -3,25 +3,22 @@ out float FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
+#include "gbuffer.glsl"
 uniform sampler2D noiseTexture;
 
-layout (std140) uniform Matrices{
-    mat4 projection;
-    mat4 view;
-};
-
 const int kernelSize = 64;
-uniform vec3 samples[kernelSize];
 
-const float radius = 0.5;
-const float bias = 0.025;
-const vec2 noiseScale = vec2(800.0/4.0, 600.0/4.0);
+// see SSAOBlock
+layout (std140) uniform SSAOParams{
+	vec4 samples[kernelSize]; // xyz
+	vec2 noiseScale;          // screen size / noise texture size
+	float radius;
+	float bias;
+};
 
 void main(){
-	vec3 fragPos = texture(gPosition, TexCoords).xyz;
-	vec3 normal = texture(gNormal, TexCoords).rgb;
+	vec3 fragPos = gBufferPosition(TexCoords);
+	vec3 normal = gBufferNormal(TexCoords);
 	vec3 randomVec = normalize(texture(noiseTexture, TexCoords * noiseScale).xyz); 
 
 	vec3 tangent   = normalize(randomVec - normal * dot(randomVec, normal));
@@ -30,13 +27,12 @@ void main(){
 
 	float occlusion = 0.0;
 	for(int i = 0; i < kernelSize; i++){
-		vec3 samplePos = fragPos + TBN * samples[i] * radius; // view space sample pos
+		vec3 samplePos = fragPos + TBN * samples[i].xyz * radius; // view space sample pos
 		
 		vec4 offset = projection * vec4(samplePos, 1.0);
 		offset.xyz /= offset.w;
 		offset.xyz = offset.xyz * 0.5 + 0.5;
-		vec3 sampleTexturePos = texture(gPosition, offset.xy).xyz;
-		float sampleDepth = sampleTexturePos.z;
+		float sampleDepth = gBufferPosition(offset.xy).z;
 
 		float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
 		occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0);
@@ -0,0 +1,948 @@
+// Generated by tools/embed_shaders.py from src/shaders, do not edit
+#include "shadersources.h"
+
+namespace {
+struct EmbeddedShader {
+	const char* path;
+	const char* source;
+};
+
+const EmbeddedShader shaders[] = {
+	{ "src/shaders/bloom.frag",
+R"glsl(#version 410 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;
+
+uniform bool horizontal;
+
+// see BloomBlock
+layout (std140) uniform BloomParams{
+    float weights[5];
+};
+
+void main(){
+    vec2 tex_offset = 1.0 / textureSize(image, 0);
+    vec3 result = texture(image, TexCoords).rgb * weights[0];
+    if(horizontal){
+        for(int i = 1; i < 5; i++){
+            result += texture(image, TexCoords + i * tex_offset * vec2(1.0, 0.0)).rgb * weights[i];
+            result += texture(image, TexCoords - i * tex_offset * vec2(1.0, 0.0)).rgb * weights[i];
+        }
+    } else {
+        for(int i = 1; i < 5; i++){
+            result += texture(image, TexCoords + i * tex_offset * vec2(0.0, 1.0)).rgb * weights[i];
+            result += texture(image, TexCoords - i * tex_offset * vec2(0.0, 1.0)).rgb * weights[i];
+        }
+    }
+
+    FragColor = vec4(result, 1.0);
+})glsl" },
+	{ "src/shaders/bloom.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+	gl_Position = vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+})glsl" },
+	{ "src/shaders/depthprepass.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+};
+#include "object.glsl"
+
+// must compute gl_Position exactly like gbuffer.vert
+invariant gl_Position;
+
+void main(){
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
+)glsl" },
+	{ "src/shaders/depthshader.frag",
+R"glsl(#version 410 core
+
+// depth only, leaving gl_FragDepth alone keeps early depth testing
+void main(){
+})glsl" },
+	{ "src/shaders/depthshader.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 lightSpaceMatrix;
+#include "object.glsl"
+
+void main(){
+	gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+})glsl" },
+	{ "src/shaders/evsm.frag",
+R"glsl(#version 410 core
+layout (location = 0) out vec4 Moments;
+
+in vec2 TexCoords;
+
+// exponential variance shadow map prefilter, see ShadowMapPass
+uniform sampler2DArray depthMap; // read without comparison
+uniform sampler2D moments;       // result of the horizontal pass
+uniform int layer;
+uniform bool horizontal;
+uniform int radius;
+uniform vec2 exponents; // positive and negative warp
+
+// both exponential warps of a [0, 1] depth with their squares, must match glighting.frag
+vec4 warp(float depth){
+    depth = 2.0 * depth - 1.0;
+    float pos = exp(exponents.x * depth);
+    float neg = -exp(-exponents.y * depth);
+    return vec4(pos, pos * pos, neg, neg * neg);
+}
+
+vec4 tap(vec2 offset){
+    if(horizontal)
+        return warp(texture(depthMap, vec3(TexCoords + offset, layer)).r);
+    return texture(moments, TexCoords + offset);
+}
+
+void main(){
+    vec2 texelSize = 1.0 / vec2(textureSize(depthMap, 0).xy);
+    vec2 direction = horizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+
+    // separable gaussian, unlike depth the moments can be filtered before the shadow test
+    float sigma = 0.5 * float(radius) + 0.5;
+    vec4 result = vec4(0.0);
+    float weightSum = 0.0;
+    for(int i = -radius; i <= radius; i++){
+        float weight = exp(-float(i * i) / (2.0 * sigma * sigma));
+        result += tap(direction * float(i)) * weight;
+        weightSum += weight;
+    }
+    Moments = result / weightSum;
+}
+)glsl" },
+	{ "src/shaders/evsm.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+	gl_Position = vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+})glsl" },
+	{ "src/shaders/gbuffer.frag",
+R"glsl(#version 410 core
+// position comes from the depth buffer, see gbuffer.glsl
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+
+in vec3 Normal;
+in vec2 TexCoords;
+in mat3 TBN;
+
+uniform sampler2D texture_diffuse;
+uniform sampler2D texture_specular;
+#ifdef NORMAL_MAP
+uniform sampler2D normal_map;
+#endif
+
+#include "octahedral.glsl"
+
+void main()
+{    
+    // store the per-fragment normals into the gbuffer
+#ifdef NORMAL_MAP
+    vec3 tangentNormal = normalize(texture(normal_map, TexCoords).rgb * 2.0 - 1.0);
+    if(dot(tangentNormal, vec3(1.0)) == 0.0){
+        gNormal = encodeNormal(TBN[2]);
+    } else {
+        gNormal = encodeNormal(TBN * tangentNormal);
+    }
+#else
+    gNormal = encodeNormal(TBN[2]);
+#endif
+    // and the diffuse per-fragment color
+    gAlbedoSpec.rgb = texture(texture_diffuse, TexCoords).rgb;
+    // store specular intensity in gAlbedoSpec's alpha component
+    gAlbedoSpec.a = texture(texture_specular, TexCoords).r;
+}   )glsl" },
+	{ "src/shaders/gbuffer.glsl",
+R"glsl(// G-buffer layout and decoding, shared by every pass that reads the G-buffer, see GBufferPass.
+//   gDepth       24 bit depth, view space position is reconstructed with the inverse projection
+//   gNormal      RG16, octahedral encoded view space normal
+//   gAlbedoSpec  RGBA8, albedo and specular intensity
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+    mat4 inverseProjection;
+};
+
+#include "octahedral.glsl"
+
+vec3 viewPositionFromDepth(vec2 uv, float depth){
+    vec4 pos = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return pos.xyz / pos.w;
+}
+
+vec3 gBufferPosition(vec2 uv){
+    return viewPositionFromDepth(uv, texture(gDepth, uv).r);
+}
+
+vec3 gBufferNormal(vec2 uv){
+    return decodeNormal(texture(gNormal, uv).rg);
+}
+)glsl" },
+	{ "src/shaders/gbuffer.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec3 aTangent;
+layout (location = 4) in vec3 aBitangent;
+
+
+out vec2 TexCoords;
+out mat3 TBN;
+
+// bit-identical to depthprepass.vert, the G-buffer is drawn with GL_EQUAL after the depth prepass
+invariant gl_Position;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+};
+#include "object.glsl"
+
+void main(){
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+
+	// view is a rigid transform, so its rotation part is its own inverse transpose
+	mat3 viewNormalMatrix = mat3(view) * normalMatrix;
+	vec3 Normal = normalize(viewNormalMatrix * aNormal);
+	vec3 Tangent = normalize(viewNormalMatrix * aTangent);
+	vec3 Bitangent = normalize(viewNormalMatrix * aBitangent);
+	TBN = mat3(Tangent, Bitangent, Normal); //tangent space to world space
+
+	TexCoords = aTexCoords;
+})glsl" },
+	{ "src/shaders/glighting.frag",
+R"glsl(#version 410 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+in vec2 TexCoords;
+
+#include "gbuffer.glsl"
+
+// variants: SSAO, SSR and CLUSTERED (off when point and spot lights are drawn as light volumes). MAX_DIR_LIGHTS,
+// CLUSTER_X/Y/Z, SPOT_LIGHT_BIT, MAX_CASCADES, POINT_SHADOW_TIERS and SHADOW_LAYER_BITS come from the C++ side.
+#ifdef SSAO
+uniform sampler2D ssao;
+#endif
+#ifdef SSR
+uniform sampler2D ssr;
+#endif
+
+struct DirLight {
+	vec4 dir, color;
+};
+
+layout (std140) uniform Lights{
+	DirLight dirLights[MAX_DIR_LIGHTS];
+	int dirLightCount;
+};
+
+// clustered point and spot lights, see LightClusters
+
+uniform samplerBuffer pointLightData; // PointLight structs, 3 texels each, shadow slot in the w of the last
+uniform samplerBuffer spotLightData;  // SpotLight structs, 5 texels each
+uniform usamplerBuffer clusterData;   // offset and count into lightIndices
+uniform usamplerBuffer lightIndices;  // spot lights are tagged with SPOT_LIGHT_BIT
+uniform float sliceScale;
+uniform float sliceBias;
+uniform vec2 screenSize;
+
+// cascaded shadow maps of the first directional light, see ShadowMapPass
+layout (std140) uniform Shadows{
+    mat4 viewToShadow[MAX_CASCADES];
+    vec4 cascadeSplits; // view space far distance of each cascade
+    vec4 texelSizes;    // world space size of a shadow map texel per cascade
+    int cascadeCount;   // 0 when shadows are off
+    int shadowFilter;
+    float evsmPositive, evsmNegative; // exponents of the warps
+    float evsmBleedReduction;
+};
+
+#define FILTER_PCF 0
+#define FILTER_EVSM 1
+
+uniform sampler2DArrayShadow shadowMap;
+uniform sampler2DArray shadowMoments; // EVSM only
+
+#include "pointshadows.glsl"
+
+// upper bound of the fraction of the filter region that is lit, from the mean and variance of its depths
+float chebyshev(vec2 moments, float depth, float minVariance){
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    // the bound is loose where occluders overlap, cutting off its tail hides the light bleeding
+    pMax = clamp((pMax - evsmBleedReduction) / (1.0 - evsmBleedReduction), 0.0, 1.0);
+    return depth <= moments.x ? 1.0 : pMax;
+}
+
+float dirShadow(vec3 fragPos, vec3 normal){
+    float depth = -fragPos.z;
+    int cascade = 0;
+    while(cascade < cascadeCount - 1 && depth > cascadeSplits[cascade])
+        cascade++;
+    if(cascadeCount == 0 || depth > cascadeSplits[cascade])
+        return 1.0;
+
+    // offset along the normal by about a texel against acne on surfaces at grazing angles
+    vec3 shadowPos = vec3(viewToShadow[cascade] * vec4(fragPos + normal * texelSizes[cascade] * 1.5, 1.0));
+
+    if(shadowFilter == FILTER_EVSM){
+        if(any(lessThan(shadowPos.xy, vec2(0.0))) || any(greaterThan(shadowPos.xy, vec2(1.0))))
+            return 1.0;
+        // mip level from the size of a screen pixel in shadow map texels. Derivatives are no use here,
+        // the cascade changes between neighbouring pixels.
+        float pixelSize = depth * 2.0 / (projection[1][1] * screenSize.y);
+        float lod = log2(max(pixelSize / texelSizes[cascade], 1.0));
+        vec4 moments = textureLod(shadowMoments, vec3(shadowPos.xy, cascade), lod);
+
+        float warped = 2.0 * shadowPos.z - 1.0;
+        float pos = exp(evsmPositive * warped);
+        float neg = -exp(-evsmNegative * warped);
+        // minimum variance scaled with the slope of each warp, against acne
+        vec2 depthScale = 0.0001 * vec2(evsmPositive, evsmNegative) * vec2(pos, neg);
+        vec2 minVariance = depthScale * depthScale;
+        return min(chebyshev(moments.xy, pos, minVariance.x), chebyshev(moments.zw, neg, minVariance.y));
+    }
+
+    // 5x5 PCF, each tap is bilinearly filtered by the hardware comparison
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for(int x = -2; x <= 2; x++)
+        for(int y = -2; y <= 2; y++)
+)glsl"
+R"glsl(            lit += texture(shadowMap, vec4(shadowPos.xy + vec2(x, y) * texelSize, cascade, shadowPos.z));
+    return lit / 25.0;
+}
+
+
+void main(){
+    vec3 FragPos = gBufferPosition(TexCoords);
+    vec3 Normal = gBufferNormal(TexCoords);
+    vec3 Albedo = texture(gAlbedoSpec, TexCoords).rgb;
+    float Specular = texture(gAlbedoSpec, TexCoords).a;
+    
+    vec3 viewDir = normalize(-FragPos);
+
+    // ambient
+#ifdef SSAO
+    float AmbientOcclusion = texture(ssao, TexCoords).r;
+    vec3 ambient = 0.1 * AmbientOcclusion * Albedo;
+#else
+    vec3 ambient = 0.1 * Albedo;
+#endif
+
+    vec3 lighting = ambient;
+
+#ifdef CLUSTERED
+    // cluster of this pixel
+    ivec2 tile = ivec2(gl_FragCoord.xy / screenSize * vec2(CLUSTER_X, CLUSTER_Y));
+    int slice = clamp(int(log(max(-FragPos.z, 1e-4)) * sliceScale + sliceBias), 0, CLUSTER_Z - 1);
+    uvec2 cluster = texelFetch(clusterData, (slice * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x).rg;
+
+    for(uint i = 0u; i < cluster.y; i++){
+        uint entry = texelFetch(lightIndices, int(cluster.x + i)).r;
+        bool spot = (entry & SPOT_LIGHT_BIT) != 0u;
+        int light = int(entry & ~SPOT_LIGHT_BIT);
+
+        vec3 lightPos, lightColor, spotDir;
+        float Linear, Quadratic, range, cutOff, outerCutOff, shadowSlot = -1.0;
+        if(spot){
+            vec4 params = texelFetch(spotLightData, 5 * light + 3);
+            lightPos = texelFetch(spotLightData, 5 * light).xyz;
+            spotDir = texelFetch(spotLightData, 5 * light + 1).xyz;
+            lightColor = texelFetch(spotLightData, 5 * light + 2).rgb;
+            cutOff = params.x; outerCutOff = params.y; Linear = params.z; Quadratic = params.w;
+            range = texelFetch(spotLightData, 5 * light + 4).x;
+        } else {
+            vec4 params = texelFetch(pointLightData, 3 * light + 2);
+            lightPos = texelFetch(pointLightData, 3 * light).xyz;
+            lightColor = texelFetch(pointLightData, 3 * light + 1).rgb;
+            Linear = params.x; Quadratic = params.y; range = params.z; shadowSlot = params.w;
+        }
+
+        lightPos = vec3(view * vec4(lightPos, 1.0));
+        vec3 lightDir = normalize(lightPos - FragPos);
+        float dist = length(lightPos - FragPos);
+        if(dist > range)
+            continue;
+
+        float intensity = pointShadow(shadowSlot, FragPos + Normal * 0.02 - lightPos, range);
+        if(spot){
+            // spot light cone
+            float theta = dot(normalize(vec3(view * vec4(spotDir, 0.0))), -lightDir);
+            float epsilon = cutOff - outerCutOff;
+            intensity *= clamp((theta - outerCutOff) / epsilon, 0.0, 1.0);
+        }
+
+        // diffuse
+        float diff = max(dot(Normal, lightDir), 0.0);
+        // specular
+        vec3 halfwayDir = normalize(lightDir + viewDir);  
+        float spec = pow(max(dot(Normal, halfwayDir), 0.0), 32.0) * Specular;
+        // attenuation
+        float attenuation = 1.0 / (1.0 + Linear * dist + Quadratic * dist * dist);
+        // result
+        lighting += intensity * attenuation * (diff + spec) * Albedo * lightColor;
+    }
+#endif
+
+    for(int i = 0; i < dirLightCount; i++){
+        vec3 lightDir = vec3(view * dirLights[i].dir);
+        // diffuse
+        float diff = max(dot(Normal, -lightDir), 0.0);
+        // specular
+        vec3 halfwayDir = normalize(-lightDir + viewDir);  
+        float spec = pow(max(dot(Normal, halfwayDir), 0.0), 32.0) * Specular;
+        // result
+        float shadow = i == 0 ? dirShadow(FragPos, Normal) : 1.0;
+        lighting += shadow * (diff + spec) * Albedo * vec3(dirLights[i].color);
+    }
+
+#ifdef SSR
+    vec2 reflectionUV = texture(ssr, TexCoords).xy;
+    float reflectionVis = texture(ssr, TexCoords).z;
+    vec3 reflectionColor = texture(gAlbedoSpec, reflectionUV).rgb;
+    lighting += reflectionColor * reflectionVis * Specular;
+#endif
+
+    FragColor = vec4(lighting, 1.0);
+
+    float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
+)glsl"
+R"glsl(    BrightColor = vec4(FragColor.rgb * vec3(brightness > 1.0), 1.0);
+})glsl" },
+	{ "src/shaders/glighting.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+	gl_Position = vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+})glsl" },
+	{ "src/shaders/hdr.frag",
+R"glsl(#version 410 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// variants: BLOOM, and TONEMAP_REINHARD or TONEMAP_EXPOSURE (neither writes the HDR color as is)
+// see HDRBlock
+layout (std140) uniform HDRParams{
+    float exposure;
+};
+uniform sampler2D hdrBuffer;
+#ifdef BLOOM
+uniform sampler2D bloom;
+#endif
+
+void main(){
+    const float gamma = 2.2;
+    vec3 hdrColor = texture(hdrBuffer, TexCoords).rgb;
+
+#ifdef BLOOM
+    vec3 bloomColor = texture(bloom, TexCoords).rgb;
+    hdrColor += bloomColor;
+#endif
+
+#if defined(TONEMAP_REINHARD)
+    // reinhard tone mapping
+    vec3 mapped = hdrColor / (hdrColor + vec3(1.0));
+    // gamma correction 
+    mapped = pow(mapped, vec3(1.0 / gamma));
+
+    FragColor = vec4(mapped, 1.0);
+#elif defined(TONEMAP_EXPOSURE)
+    vec3 mapped = vec3(1.0) - exp(-hdrColor * exposure);
+    mapped = pow(mapped, vec3(1.0 / gamma));
+
+    FragColor = vec4(mapped, 1.0);
+#else
+    FragColor = vec4(hdrColor, 1.0);
+#endif
+})glsl" },
+	{ "src/shaders/hdr.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+	gl_Position = vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+})glsl" },
+	{ "src/shaders/lightcube.frag",
+R"glsl(#version 410 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+struct PointLight {
+	vec4 pos, color;
+	float Linear, Quadratic, pad1, pad2;
+};
+
+struct DirLight {
+	vec4 dir, color;
+};
+
+struct SpotLight {
+	vec3 pos, dir, color;
+	float cutoff, Linear, Quadratic, pad3;
+};
+
+#define NR_POINT_LIGHTS 100
+#define NR_DIR_LIGHTS 2
+#define NR_SPOT_LIGHTS 100
+
+layout (std140) uniform Lights{
+	PointLight pointLights[NR_POINT_LIGHTS];
+	DirLight dirLights[NR_DIR_LIGHTS];
+	SpotLight spotLights[NR_SPOT_LIGHTS];
+};
+
+uniform uint lightIndex;
+
+void main(){
+    FragColor = vec4(vec3(pointLights[lightIndex].color), 1.0);
+
+    float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
+    BrightColor = vec4(FragColor.rgb * vec3(brightness > 1.0), 1.0);
+})glsl" },
+	{ "src/shaders/lightcube.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+};
+uniform mat4 model;
+
+void main()
+{
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+})glsl" },
+	{ "src/shaders/lightvolume.frag",
+R"glsl(#version 410 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+#include "gbuffer.glsl"
+
+uniform vec2 screenSize;
+
+// a single point or spot light, blended additively over the ambient and directional lighting
+uniform vec3 lightPos;
+uniform vec3 lightDir;
+uniform vec3 lightColor;
+uniform float range;
+uniform float Linear;
+uniform float Quadratic;
+uniform bool spot;
+uniform float cutOff;
+uniform float outerCutOff;
+uniform float shadowSlot; // point lights only, see PointShadowPass
+
+#include "pointshadows.glsl"
+
+void main(){
+    vec2 TexCoords = gl_FragCoord.xy / screenSize;
+    vec3 FragPos = gBufferPosition(TexCoords);
+    vec3 Normal = gBufferNormal(TexCoords);
+    vec3 Albedo = texture(gAlbedoSpec, TexCoords).rgb;
+    float Specular = texture(gAlbedoSpec, TexCoords).a;
+
+    vec3 viewDir = normalize(-FragPos);
+    vec3 viewLightPos = vec3(view * vec4(lightPos, 1.0));
+    vec3 L = normalize(viewLightPos - FragPos);
+    float dist = length(viewLightPos - FragPos);
+    if(dist > range)
+        discard;
+
+    float intensity = pointShadow(shadowSlot, FragPos + Normal * 0.02 - viewLightPos, range);
+    if(spot){
+        float theta = dot(normalize(vec3(view * vec4(lightDir, 0.0))), -L);
+        float epsilon = cutOff - outerCutOff;
+        intensity *= clamp((theta - outerCutOff) / epsilon, 0.0, 1.0);
+    }
+
+    // diffuse
+    float diff = max(dot(Normal, L), 0.0);
+    // specular
+    vec3 halfwayDir = normalize(L + viewDir);
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 32.0) * Specular;
+    // attenuation
+    float attenuation = 1.0 / (1.0 + Linear * dist + Quadratic * dist * dist);
+    vec3 lighting = intensity * attenuation * (diff + spec) * Albedo * lightColor;
+
+    FragColor = vec4(lighting, 1.0);
+
+    // thresholded per light, so a pixel only blooms when a single light makes it bright
+    float brightness = dot(lighting, vec3(0.2126, 0.7152, 0.0722));
+    BrightColor = vec4(lighting * vec3(brightness > 1.0), 1.0);
+}
+)glsl" },
+	{ "src/shaders/lightvolume.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+    mat4 inverseProjection; // declared by gbuffer.glsl in the fragment stage, the blocks must match
+};
+
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
+)glsl" },
+	{ "src/shaders/lightvolumestencil.frag",
+R"glsl(#version 410 core
+
+// only the stencil is written while marking the pixels inside a light volume
+void main()
+{
+}
+)glsl" },
+	{ "src/shaders/object.glsl",
+R"glsl(// per-object constants of the render list, see ObjectBlock
+layout (std140) uniform Object{
+    mat4 model;
+    mat3 normalMatrix; // inverse transpose of model, computed on the CPU
+};
+)glsl" },
+	{ "src/shaders/octahedral.glsl",
+R"glsl(// octahedral normal encoding, two components with an even error over the sphere
+
+vec2 octWrap(vec2 v){
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// unit vector to [0, 1]^2: project onto the octahedron, fold the lower half over the upper one
+vec2 encodeNormal(vec3 n){
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+    return e * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 e){
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+)glsl" },
+	{ "src/shaders/pointshadow.frag",
+R"glsl(#version 410 core
+in vec3 FragPos;
+
+uniform vec3 lightPos;
+uniform float range;
+
+// linear distance, the same for every face so the lighting shader does not need the face projection
+void main(){
+	gl_FragDepth = length(FragPos - lightPos) / range;
+})glsl" },
+	{ "src/shaders/pointshadow.geom",
+R"glsl(#version 410 core
+// one invocation per cube face, each writes its copy of the triangle to the face layer of the light
+layout (triangles, invocations = 6) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+uniform mat4 shadowMatrices[6];
+uniform int layer;
+
+out vec3 FragPos;
+
+void main(){
+	gl_Layer = layer * 6 + gl_InvocationID;
+	for(int i = 0; i < 3; i++){
+		FragPos = gl_in[i].gl_Position.xyz;
+		gl_Position = shadowMatrices[gl_InvocationID] * gl_in[i].gl_Position;
+		EmitVertex();
+	}
+	EndPrimitive();
+})glsl" },
+	{ "src/shaders/pointshadow.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+
+#include "object.glsl"
+
+// world space, the geometry shader projects once per cube face
+void main(){
+	gl_Position = model * vec4(aPos, 1.0);
+})glsl" },
+	{ "src/shaders/pointshadows.glsl",
+R"glsl(// point light shadows, see PointShadowPass. POINT_SHADOW_TIERS and SHADOW_LAYER_BITS come from the C++ side,
+// the switch below assumes 4 tiers. Needs the view matrix from gbuffer.glsl.
+uniform samplerCubeArrayShadow pointShadowMaps[POINT_SHADOW_TIERS];
+
+// the cube maps store distance / range, lightToFrag is in view space
+float pointShadow(float slot, vec3 lightToFrag, float range){
+    if(slot < 0.0)
+        return 1.0;
+    int s = int(slot);
+    vec4 coord = vec4(transpose(mat3(view)) * lightToFrag, float(s & ((1 << SHADOW_LAYER_BITS) - 1)));
+    float ref = (length(lightToFrag) - 0.05) / range;
+    // sampler arrays may only be indexed with constants here
+    switch(s >> SHADOW_LAYER_BITS){
+        case 0: return texture(pointShadowMaps[0], coord, ref);
+        case 1: return texture(pointShadowMaps[1], coord, ref);
+        case 2: return texture(pointShadowMaps[2], coord, ref);
+        default: return texture(pointShadowMaps[3], coord, ref);
+    }
+}
+)glsl" },
+	{ "src/shaders/skybox.frag",
+R"glsl(#version 410 core
+out vec4 FragColor;
+
+in vec3 TexCoords;
+
+uniform samplerCube cubemap;
+
+void main(){
+    FragColor = texture(cubemap, TexCoords);
+})glsl" },
+	{ "src/shaders/skybox.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+
+out vec3 TexCoords;
+
+layout (std140) uniform Matrices{
+    mat4 projection;
+    mat4 view;
+};
+
+void main()
+{
+	TexCoords = aPos;
+	vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0);
+	gl_Position = pos.xyww;
+})glsl" },
+	{ "src/shaders/ssao.frag",
+R"glsl(#version 410 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+#include "gbuffer.glsl"
+uniform sampler2D noiseTexture;
+
+const int kernelSize = 64;
+
+// see SSAOBlock
+layout (std140) uniform SSAOParams{
+	vec4 samples[kernelSize]; // xyz
+	vec2 noiseScale;          // screen size / noise texture size
+	float radius;
+	float bias;
+};
+
+void main(){
+	vec3 fragPos = gBufferPosition(TexCoords);
+	vec3 normal = gBufferNormal(TexCoords);
+	vec3 randomVec = normalize(texture(noiseTexture, TexCoords * noiseScale).xyz); 
+
+	vec3 tangent   = normalize(randomVec - normal * dot(randomVec, normal));
+	vec3 bitangent = cross(normal, tangent);
+	mat3 TBN = mat3(tangent, bitangent, normal);
+
+	float occlusion = 0.0;
+	for(int i = 0; i < kernelSize; i++){
+		vec3 samplePos = fragPos + TBN * samples[i].xyz * radius; // view space sample pos
+		
+		vec4 offset = projection * vec4(samplePos, 1.0);
+		offset.xyz /= offset.w;
+		offset.xyz = offset.xyz * 0.5 + 0.5;
+		float sampleDepth = gBufferPosition(offset.xy).z;
+
+		float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
+		occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0);
+	}
+	occlusion = 1.0 - (occlusion / kernelSize);
+	FragColor = occlusion;
+})glsl" },
+	{ "src/shaders/ssao.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+	gl_Position = vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+})glsl" },
+	{ "src/shaders/ssaoblur.frag",
+R"glsl(#version 410 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput;
+
+void main(){
+	vec2 texelSize = 1.0 / vec2(textureSize(ssaoInput, 0));
+	float result = 0.0;
+	for(int x = -2; x <= 2; x++){
+		for(int y = -2; y <= 2; y++){
+			result += texture(ssaoInput, TexCoords + vec2(float(x),float(y)) * texelSize).r;
+		}
+	}
+	FragColor = result / 25.0;
+})glsl" },
+	{ "src/shaders/ssaoblur.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+	gl_Position = vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+})glsl" },
+	{ "src/shaders/ssr.frag",
+R"glsl(#version 410 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+#include "gbuffer.glsl"
+
+float maxDistance = 3;
+float resolution = 0.1;
+float maxSteps = maxDistance / resolution;
+int bsSteps = 50;
+float thickness = 0.05;
+
+vec3 RayCast(vec3 origin, vec3 dir, out float dDepth);
+vec3 BinarySearch(vec3 start, vec3 dir, out float dDepth);
+vec2 viewToUV(vec4 pos);
+
+void main(){
+	vec3 fragPos = gBufferPosition(TexCoords);
+	vec3 fragDir = normalize(fragPos);
+	vec3 normal = gBufferNormal(TexCoords);
+	vec3 reflectDir = reflect(fragDir, normal);
+
+	float dDepth;
+	FragColor = vec4(RayCast(fragPos, reflectDir, dDepth), 1.0);
+	// store visibility in z coord of output
+	FragColor.z *=  (1 - max(dot(-fragDir, reflectDir), 0.0)) * (1 - clamp(dDepth / thickness, 0.0, 1.0)) *
+			(1 - clamp(length((gBufferPosition(FragColor.xy) - fragPos)) / maxDistance, 0.0, 1.0)) *
+			(FragColor.x < 0 || FragColor.x > 1 ? 0 : 1) * (FragColor.y < 0 || FragColor.y > 1 ? 0 : 1) *
+			16 * FragColor.x * (1 - FragColor.x) * FragColor.y * (1 - FragColor.y);
+	FragColor.z = clamp(FragColor.z, 0.0, 1.0);
+}
+
+// return uv of hit
+vec3 RayCast(vec3 origin, vec3 dir, out float dDepth){
+	float sceneDepth;
+	vec2 projectedCoord;
+
+	vec3 hitCoord = origin;
+	for(int i = 0; i < maxSteps; i++){
+		hitCoord += dir * resolution;
+		projectedCoord = viewToUV(vec4(hitCoord, 1.0));
+		sceneDepth = gBufferPosition(projectedCoord.xy).z;
+
+		float dDepth = sceneDepth - hitCoord.z;
+		if(dDepth > 0.0 && dDepth <= thickness){
+			return BinarySearch(hitCoord, dir, dDepth);
+		}
+	}
+	return vec3(0.0);
+}
+
+vec3 BinarySearch(vec3 start, vec3 dir, out float dDepth){
+	float sceneDepth;
+	vec2 projectedCoord;
+
+	vec3 hitCoord = start;
+	for(int i = 0; i < bsSteps; i++){
+		projectedCoord = viewToUV(vec4(hitCoord, 1.0));
+		sceneDepth = gBufferPosition(projectedCoord).z;
+		
+		float dDepth = sceneDepth - hitCoord.z;
+		resolution *= 0.5;
+		hitCoord += -sign(dDepth) * dir * resolution;
+	}
+
+	return vec3(viewToUV(vec4(hitCoord, 1.0)), 1.0);
+}
+
+vec2 viewToUV(vec4 pos){
+	pos = projection * pos;
+	pos.xy /= pos.w;
+	pos.xy = pos.xy * 0.5 + 0.5;
+	return pos.xy;
+})glsl" },
+	{ "src/shaders/ssr.vert",
+R"glsl(#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+	gl_Position = vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+})glsl" },
+};
+}
+
+const char* embeddedShaderSource(const std::string& path)
+{
+	for (const EmbeddedShader& shader : shaders)
+		if (path == shader.path) return shader.source;
+	return nullptr;
+}
@@ -0,0 +1,10 @@
+#ifndef SHADER_SOURCES_H
+#define SHADER_SOURCES_H
+
+#include <string>
+
+// The shaders of src/shaders compiled into the executable, generated by tools/embed_shaders.py.
+// Returns the source of a path such as "src/shaders/hdr.frag", or nullptr when it is not embedded.
+const char* embeddedShaderSource(const std::string& path);
+
+#endif
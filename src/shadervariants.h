@@ -0,0 +1,112 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "shader.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Programs of one shader for every combination of its features. Bit i of a variant mask defines features[i], on top
+// of the defines shared by all variants, so each combination compiles to its own program without runtime branches.
+// Variants are compiled the first time they are requested, init sets up the uniforms of each new one once it is linked
+// (sampler units, uniform block bindings, settings the pass applies with forEach). prewarm() and select() compile in
+// the background through ShaderCompiler, select() keeps returning the variant it returned last until the requested one
+// is ready, so a feature switched on mid-session never stalls a frame.
+class ShaderVariants
+{
+public:
+	ShaderVariants(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& features,
+		const std::vector<std::string>& defines = {}, std::function<void(Shader&)> init = nullptr)
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), features(features), defines(defines), init(init)
+	{
+	}
+
+	unsigned int bit(const std::string& feature) const
+	{
+		for (unsigned int i = 0; i < features.size(); i++)
+			if (features[i] == feature) return 1u << i;
+		return 0;
+	}
+
+	// blocks until the variant is compiled
+	Shader& get(unsigned int mask)
+	{
+		Variant& variant = request(mask, false);
+		variant.shader->finish();
+		initialize(variant);
+		last = variant.shader.get();
+		return *last;
+	}
+
+	// the variant if it is ready, the one returned last while it compiles, blocks only when there is none yet
+	Shader& select(unsigned int mask)
+	{
+		Variant& variant = request(mask, true);
+		if (variant.shader->ready()) {
+			initialize(variant);
+			last = variant.shader.get();
+		}
+		return last ? *last : get(mask);
+	}
+
+	// starts compiling the variants in the background
+	void prewarm(const std::vector<unsigned int>& masks)
+	{
+		for (unsigned int mask : masks) request(mask, true);
+	}
+	void prewarmAll()
+	{
+		for (unsigned int mask = 0; mask < (1u << features.size()); mask++) request(mask, true);
+	}
+
+	// on the linked variants, the others get the settings through init
+	template<typename F>
+	void forEach(F f)
+	{
+		for (auto& variant : variants) {
+			if (!variant.second.initialized) continue;
+			variant.second.shader->use();
+			f(*variant.second.shader);
+		}
+	}
+
+	size_t size() const { return variants.size(); }
+
+private:
+	std::string vertexPath, fragmentPath;
+	std::vector<std::string> features, defines;
+	std::function<void(Shader&)> init;
+	struct Variant {
+		std::unique_ptr<Shader> shader;
+		bool initialized = false;
+	};
+	std::map<unsigned int, Variant> variants;
+	Shader* last = nullptr;
+
+	Variant& request(unsigned int mask, bool async)
+	{
+		Variant& variant = variants[mask];
+		if (!variant.shader) {
+			std::vector<std::string> variantDefines = defines;
+			for (unsigned int i = 0; i < features.size(); i++)
+				if (mask & (1u << i)) variantDefines.push_back(features[i]);
+			variant.shader = std::make_unique<Shader>(vertexPath.c_str(), fragmentPath.c_str(), variantDefines, async);
+		}
+		return variant;
+	}
+
+	void initialize(Variant& variant)
+	{
+		if (variant.initialized) return;
+		variant.initialized = true;
+		if (init) {
+			variant.shader->use();
+			init(*variant.shader);
+		}
+	}
+};
+
+#endif
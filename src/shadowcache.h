@@ -0,0 +1,59 @@
+#ifndef SHADOWCACHE_H
+#define SHADOWCACHE_H
+
+#include <glad/glad.h>
+
+#include "glstate.h"
+
+// Shadow views keep the depth of their static casters in a second texture. The static layers are redrawn only when
+// the view moves or a static model overlapping it changes, every other frame they are copied over the shadow map
+// and just the dynamic casters are drawn on top.
+struct ShadowCacheStats {
+	unsigned int hits = 0;    // frames the static layers were reused
+	unsigned int redraws = 0; // frames the static layers were drawn again
+};
+
+// Clears and copies single layers of depth array textures through two framebuffers, since a layered attachment
+// can only be cleared as a whole and blits only read layer 0
+class DepthLayerCopier {
+private:
+	unsigned int readFBO, drawFBO;
+
+public:
+	DepthLayerCopier() {
+		glGenFramebuffers(1, &readFBO);
+		glGenFramebuffers(1, &drawFBO);
+		for (unsigned int fbo : { readFBO, drawFBO }) {
+			GLState::bindFramebuffer(fbo);
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		GLState::bindFramebuffer(0);
+	}
+	~DepthLayerCopier() {
+		GLState::deleteFramebuffers(1, &readFBO);
+		GLState::deleteFramebuffers(1, &drawFBO);
+	}
+	DepthLayerCopier(const DepthLayerCopier&) = delete;
+	DepthLayerCopier& operator=(const DepthLayerCopier&) = delete;
+
+	void clear(unsigned int texture, unsigned int firstLayer, unsigned int count) {
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+		for (unsigned int layer = firstLayer; layer < firstLayer + count; layer++) {
+			glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+	}
+
+	// both textures need the same size and depth format
+	void copy(unsigned int source, unsigned int destination, unsigned int firstLayer, unsigned int count, unsigned int size) {
+		GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+		for (unsigned int layer = firstLayer; layer < firstLayer + count; layer++) {
+			glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, source, 0, layer);
+			glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, destination, 0, layer);
+			glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+};
+#endif
@@ -1,65 +1,427 @@
 #include "shadowmap.h"
 
-glm::mat4 ShadowMapPass::createLightFrustum()
-{
-	return glm::mat4();
-}
+#include <string>
+
+#include <imgui/imgui.h>
 
-ShadowMapPass::ShadowMapPass(unsigned int width, unsigned int height, LightType lightType) : RenderPass(width, height), lightType(lightType)
+ShadowMapPass::ShadowMapPass(unsigned int resolution, std::shared_ptr<RenderList> renderList, std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene, std::shared_ptr<JobSystem> jobSystem) : RenderPass(resolution, resolution)
 {
+	this->resolution = resolution;
+	this->renderList = renderList;
+	this->camera = camera;
+	this->scene = scene;
+	this->jobSystem = jobSystem;
+
 	glGenFramebuffers(1, &depthMapFBO);
 
+	// hardware depth comparison, sampled as sampler2DArrayShadow; outside the map counts as lit
 	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	GLState::bindTexture(GL_TEXTURE_2D_ARRAY, depthMap);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	allocateDepthMap(depthMap);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	// static casters only, never sampled
+	glGenTextures(1, &staticDepthMap);
+	GLState::bindTexture(GL_TEXTURE_2D_ARRAY, staticDepthMap);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	allocateDepthMap(staticDepthMap);
+	copier = std::make_unique<DepthLayerCopier>();
 
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthMap, 0);
+	GLState::bindFramebuffer(depthMapFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthMap, 0, 0);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Framebuffer not complete!" << std::endl;
+	GLState::bindFramebuffer(0);
+
+	// EVSM: the horizontal blur goes to blurTexture, the vertical one to a layer of momentsMap
+	glGenFramebuffers(1, &momentsFBO);
+	glGenFramebuffers(1, &blurFBO);
+	glGenSamplers(1, &depthSampler);
+	glSamplerParameteri(depthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glSamplerParameteri(depthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glSamplerParameteri(depthSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(depthSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(depthSampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+	allocateMoments();
 
-	depthShader = std::make_shared<Shader>("src/shaders/depthshader.vert", "src/shaders/depthshader.frag");
+	depthShader = std::make_unique<Shader>("src/shaders/depthshader.vert", "src/shaders/depthshader.frag");
+	depthShader->bindUniformBlock("Object", RenderList::OBJECT_BINDING);
+	momentsShader = std::make_unique<Shader>("src/shaders/evsm.vert", "src/shaders/evsm.frag");
+	momentsShader->use();
+	momentsShader->setInt("depthMap", 0);
+	momentsShader->setInt("moments", 1);
 }
 
 ShadowMapPass::~ShadowMapPass()
 {
-	glDeleteTextures(1, &depthMap);
-	glDeleteFramebuffers(1, &depthMapFBO);
+	GLState::deleteTextures(1, &depthMap);
+	GLState::deleteTextures(1, &staticDepthMap);
+	GLState::deleteTextures(1, &momentsMap);
+	GLState::deleteTextures(1, &blurTexture);
+	GLState::deleteFramebuffers(1, &depthMapFBO);
+	GLState::deleteFramebuffers(1, &momentsFBO);
+	GLState::deleteFramebuffers(1, &blurFBO);
+	glDeleteSamplers(1, &depthSampler);
+}
+
+void ShadowMapPass::allocateDepthMap(unsigned int texture)
+{
+	TARGET_WIDTH = TARGET_HEIGHT = resolution;
+	GLState::bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+}
+
+// The moments only exist while EVSM is selected, at 16 bytes per texel they cost four times the depth map.
+// 32 bit floats are needed to hold the positive warp exp(40)^2.
+void ShadowMapPass::allocateMoments()
+{
+	size_t texels = (size_t)resolution * resolution;
+	memoryUsed = 2 * texels * cascadeCount * 4;
+	if (filter != Filter::EVSM) {
+		GLState::deleteTextures(1, &momentsMap);
+		GLState::deleteTextures(1, &blurTexture);
+		momentsMap = blurTexture = 0;
+		return;
+	}
+
+	if (momentsMap == 0) {
+		glGenTextures(1, &momentsMap);
+		GLState::bindTexture(GL_TEXTURE_2D_ARRAY, momentsMap);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glGenTextures(1, &blurTexture);
+		GLState::bindTexture(GL_TEXTURE_2D, blurTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	// level 0 here, the mip chain is allocated by the first glGenerateMipmap
+	GLState::bindTexture(GL_TEXTURE_2D_ARRAY, momentsMap);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA32F, resolution, resolution, cascadeCount, 0, GL_RGBA, GL_FLOAT, NULL);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	GLState::bindTexture(GL_TEXTURE_2D, blurTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, resolution, resolution, 0, GL_RGBA, GL_FLOAT, NULL);
+
+	GLState::bindFramebuffer(blurFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blurTexture, 0);
+	GLState::bindFramebuffer(momentsFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, momentsMap, 0, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Framebuffer not complete!" << std::endl;
+	GLState::bindFramebuffer(0);
+
+	memoryUsed += texels * cascadeCount * 16 * 4 / 3 + texels * 16;
+}
+
+void ShadowMapPass::setCascades(unsigned int count, unsigned int resolution)
+{
+	count = glm::clamp(count, 1u, (unsigned int)MAX_CASCADES);
+	if (count != cascadeCount || resolution != this->resolution) {
+		cascadeCount = count;
+		this->resolution = resolution;
+		allocateDepthMap(depthMap);
+		allocateDepthMap(staticDepthMap);
+		allocateMoments();
+	}
+	invalidate();
+}
+
+void ShadowMapPass::setFilter(Filter filter)
+{
+	if (filter != this->filter) {
+		this->filter = filter;
+		allocateMoments();
+	}
+	invalidate();
+}
+
+// redraws every cascade next frame
+void ShadowMapPass::invalidate()
+{
+	for (auto& cascade : cascades) {
+		cascade.dirty = true;
+		cascade.cacheValid = false;
+	}
+}
+
+// Practical split scheme: a blend of logarithmic splits, which keep the texel density even in depth but
+// starve the far cascades, and uniform splits
+void ShadowMapPass::computeSplits()
+{
+	float zNear = camera->ZNear, zFar = glm::min(camera->ZFar, shadowDistance);
+	for (unsigned int i = 0; i < cascadeCount; i++) {
+		float p = (i + 1) / (float)cascadeCount;
+		float logSplit = zNear * glm::pow(zFar / zNear, p);
+		float uniformSplit = zNear + (zFar - zNear) * p;
+		float split = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+		if (split != cascades[i].split) {
+			cascades[i].split = split;
+			cascades[i].dirty = true;
+		}
+	}
+}
+
+// Fits the cascade to the bounding sphere of the camera frustum slice [zNear, zFar]. The sphere only depends on
+// the slice and the camera's FOV, and the light view is rotated but never translated, so snapping the sphere
+// centre to whole texels keeps the rasterisation of static casters identical from frame to frame.
+void ShadowMapPass::fitCascade(Cascade& cascade, float zNear, float zFar, const glm::vec3& lightDir)
+{
+	// smallest sphere through the near and far corners of the slice, its centre lies on the view axis
+	float tanHalfV = glm::tan(glm::radians(camera->Zoom) * 0.5f);
+	float tanHalfH = tanHalfV * camera->Aspect;
+	float k2 = tanHalfV * tanHalfV + tanHalfH * tanHalfH;
+	float centerZ = 0.5f * (zNear + zFar) * (1.0f + k2);
+	float radius;
+	if (centerZ >= zFar) {
+		centerZ = zFar;
+		radius = zFar * glm::sqrt(k2);
+	}
+	else {
+		radius = glm::sqrt((zFar - centerZ) * (zFar - centerZ) + zFar * zFar * k2);
+	}
+	// round up so the cascade size does not flicker with float noise
+	radius = glm::ceil(radius * 16.0f) / 16.0f;
+	glm::vec3 center = camera->Position + camera->Front * centerZ;
+
+	glm::vec3 up = glm::abs(lightDir.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+
+	float texelSize = 2.0f * radius / resolution;
+	glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+	lightCenter.x = glm::floor(lightCenter.x / texelSize) * texelSize;
+	lightCenter.y = glm::floor(lightCenter.y / texelSize) * texelSize;
+
+	glm::mat4 lightProjection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius,
+		-lightCenter.z - radius, -lightCenter.z + radius);
+	cascade.lightSpace = lightProjection * lightView;
+	cascade.texelSize = texelSize;
+
+	// cull against the sides and the far end of the box. There is no near plane: casters between the light and the box
+	// still shadow it and are flattened onto the near plane by depth clamping.
+	glm::vec3 right(lightView[0][0], lightView[1][0], lightView[2][0]);
+	glm::vec3 lightUp(lightView[0][1], lightView[1][1], lightView[2][1]);
+	center = glm::transpose(glm::mat3(lightView)) * lightCenter;
+	Camera::Frustum& frustum = cascade.bounds;
+	frustum.leftFace = { center - right * radius, right };
+	frustum.rightFace = { center + right * radius, -right };
+	frustum.bottomFace = { center - lightUp * radius, lightUp };
+	frustum.topFace = { center + lightUp * radius, -lightUp };
+	frustum.farFace = { center + lightDir * radius, -lightDir };
+	frustum.nearFace = { center, glm::vec3(0.0f) };
+	renderList->cull(frustum, cascade.casters, *jobSystem);
 }
 
 void ShadowMapPass::Render()
 {
+	cascadesUpdated = 0;
+	if (!enabled || scene->lights.dirLights.size() == 0) {
+		invalidate(); // static changes are not tracked meanwhile
+		uploadShadowBlock();
+		return;
+	}
+	timer.begin();
+
+	glm::vec3 lightDir = glm::normalize(glm::vec3(scene->lights.dirLights[0].dir));
+	if (lightDir != lastLightDir) {
+		lastLightDir = lightDir;
+		invalidate();
+	}
+	computeSplits();
+
+	// a static model changed inside a cascade: redraw it now instead of waiting for its turn
+	for (unsigned int c = 0; c < cascadeCount; c++) {
+		for (auto& change : renderList->staticChanges) {
+			if (cascades[c].cacheValid && RenderList::intersects(cascades[c].bounds, change)) {
+				cascades[c].cacheValid = false;
+				cascades[c].dirty = true;
+				break;
+			}
+		}
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
 	glViewport(0, 0, TARGET_WIDTH, TARGET_HEIGHT);
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glClear(GL_DEPTH_BUFFER_BIT);
-	glm::mat4 lightSpaceMatrix = createLightFrustum();
+	GLState::bindFramebuffer(depthMapFBO);
+	GLState::enable(GL_DEPTH_CLAMP);
+	GLState::enable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.5f, 2.0f);
 
+	bool changed[MAX_CASCADES] = {};
 	depthShader->use();
-	depthShader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-	for (auto&& entity : scene->root->children) {
-		entity->updateTransformMatrix();
-		renderEntityToDepthMap(*entity);
+	for (unsigned int c = 0; c < cascadeCount; c++) {
+		Cascade& cascade = cascades[c];
+		int interval = glm::max(updateIntervals[c], 1);
+		if (!cascade.dirty && (frameIndex + c) % interval != 0) continue;
+
+		fitCascade(cascade, c == 0 ? camera->ZNear : cascades[c - 1].split, cascade.split, lightDir);
+		casterCounts[c] = (unsigned int)cascade.casters.size();
+		cascade.dirty = false;
+		cascadesUpdated++;
+
+		staticCasters.clear();
+		dynamicCasters.clear();
+		for (unsigned int i : cascade.casters)
+			(renderList->items[i].isStatic ? staticCasters : dynamicCasters).push_back(i);
+		depthShader->setMat4("lightSpaceMatrix", cascade.lightSpace);
+
+		bool staticStale = !cascade.cacheValid || cascade.lightSpace != cascade.cachedLightSpace;
+		if (staticStale) {
+			GLState::bindFramebuffer(depthMapFBO);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticDepthMap, 0, c);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			drawCasters(staticCasters);
+			cascade.cachedLightSpace = cascade.lightSpace;
+			cascade.cacheValid = true;
+			cascade.stats.redraws++;
+		}
+		else {
+			cascade.stats.hits++;
+		}
+
+		// nothing to do when the shadow map already equals the unchanged cache
+		if (!staticStale && dynamicCasters.empty() && !cascade.hadDynamic) continue;
+		copier->copy(staticDepthMap, depthMap, c, 1, resolution);
+		GLState::bindFramebuffer(depthMapFBO);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthMap, 0, c);
+		drawCasters(dynamicCasters);
+		cascade.hadDynamic = !dynamicCasters.empty();
+		changed[c] = true;
+	}
+
+	GLState::disable(GL_POLYGON_OFFSET_FILL);
+	GLState::disable(GL_DEPTH_CLAMP);
+
+	if (filter == Filter::EVSM) {
+		bool any = false;
+		GLState::disable(GL_DEPTH_TEST);
+		for (unsigned int c = 0; c < cascadeCount; c++) {
+			if (!changed[c]) continue;
+			prefilter(c);
+			any = true;
+		}
+		GLState::enable(GL_DEPTH_TEST);
+		// all layers at once, the untouched ones come out the same
+		if (any) {
+			GLState::bindTexture(GL_TEXTURE_2D_ARRAY, momentsMap);
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		}
+	}
+
+	GLState::bindFramebuffer(0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	timer.end();
+
+	uploadShadowBlock();
+	frameIndex++;
+}
+
+// Converts a cascade's depth to warped moments, blurring along x on the way, then blurs along y into the
+// cascade's layer of the moments array
+void ShadowMapPass::prefilter(unsigned int cascade)
+{
+	momentsShader->use();
+	momentsShader->setInt("layer", cascade);
+	momentsShader->setInt("radius", blurRadius);
+	momentsShader->setVec2("exponents", evsmExponents[0], evsmExponents[1]);
+
+	GLState::bindFramebuffer(blurFBO);
+	momentsShader->setBool("horizontal", true);
+	GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, depthMap);
+	glBindSampler(0, depthSampler);
+	RenderQuad();
+	glBindSampler(0, 0);
+
+	GLState::bindFramebuffer(momentsFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, momentsMap, 0, cascade);
+	momentsShader->setBool("horizontal", false);
+	GLState::bindTexture(1, GL_TEXTURE_2D, blurTexture);
+	RenderQuad();
+}
+
+void ShadowMapPass::drawCasters(const std::vector<unsigned int>& items)
+{
+	for (unsigned int i : items) {
+		renderList->bindObject(i);
+		renderList->items[i].mesh->DrawDepth();
 	}
 }
 
-void ShadowMapPass::ResizeBuffers(unsigned int width, unsigned int height)
+// The lighting pass works in view space, so the cascade matrices are combined with the inverse view here
+// and the block is written to the constant ring every frame
+void ShadowMapPass::uploadShadowBlock()
 {
-	TARGET_WIDTH = width; TARGET_HEIGHT = height;
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	ShadowBlock block = {};
+	block.cascadeCount = (enabled && scene->lights.dirLights.size() > 0) ? cascadeCount : 0;
+	block.filter = (int)filter;
+	block.evsmExponents[0] = evsmExponents[0];
+	block.evsmExponents[1] = evsmExponents[1];
+	block.evsmBleedReduction = evsmBleedReduction;
+	glm::mat4 bias = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)), glm::vec3(0.5f));
+	glm::mat4 inverseView = glm::inverse(camera->matrices.view);
+	for (unsigned int c = 0; c < cascadeCount; c++) {
+		block.viewToShadow[c] = bias * cascades[c].lightSpace * inverseView;
+		block.cascadeSplits[c] = cascades[c].split;
+		block.texelSizes[c] = cascades[c].texelSize;
+	}
+
+	ConstantRing::bind(2, ConstantRing::write(block), sizeof(ShadowBlock));
 }
 
-void ShadowMapPass::renderEntityToDepthMap(Entity& entity)
+void ShadowMapPass::bindTextures() const
 {
-	depthShader->setMat4("model", entity.transform.getModelMatrix());
-	entity.model->DrawDepth();
-	for (auto&& child : entity.children) {
-		renderEntityToDepthMap(*child);
+	GLState::bindTexture(SHADOW_MAP_UNIT, GL_TEXTURE_2D_ARRAY, depthMap);
+	GLState::bindTexture(SHADOW_MOMENTS_UNIT, GL_TEXTURE_2D_ARRAY, momentsMap);
+}
+
+void ShadowMapPass::renderUI()
+{
+	ImGui::Checkbox("Directional light shadows", &enabled);
+
+	int count = cascadeCount;
+	if (ImGui::SliderInt("Cascades", &count, 1, MAX_CASCADES))
+		setCascades(count, resolution);
+
+	const char* resolutions[] = { "512", "1024", "2048", "4096" };
+	int resolutionIndex = 0;
+	while (resolutionIndex < 3 && (512u << resolutionIndex) < resolution) resolutionIndex++;
+	if (ImGui::Combo("Resolution", &resolutionIndex, resolutions, IM_ARRAYSIZE(resolutions)))
+		setCascades(cascadeCount, 512u << resolutionIndex);
+
+	int filterIndex = (int)filter;
+	if (ImGui::Combo("Filter", &filterIndex, filterNames, IM_ARRAYSIZE(filterNames)))
+		setFilter((Filter)filterIndex);
+	if (filter == Filter::EVSM) {
+		if (ImGui::SliderInt("Blur radius", &blurRadius, 0, 6))
+			invalidate();
+		if (ImGui::DragFloat2("EVSM exponents", evsmExponents, 0.1f, 1.0f, 42.0f))
+			invalidate();
+		ImGui::SliderFloat("Light bleed reduction", &evsmBleedReduction, 0.0f, 0.9f);
+	}
+
+	if (ImGui::SliderFloat("Split lambda", &splitLambda, 0.0f, 1.0f))
+		invalidate();
+	if (ImGui::DragFloat("Shadow distance", &shadowDistance, 1.0f, 1.0f, 1000.0f))
+		invalidate();
+
+	for (unsigned int c = 0; c < cascadeCount; c++) {
+		ImGui::SliderInt(("Cascade " + std::to_string(c) + " update interval").c_str(), &updateIntervals[c], 1, 8);
+		ImGui::SameLine();
+		ImGui::Text("to %.1f, %u casters, cache %u hits / %u redraws", cascades[c].split, casterCounts[c], cascades[c].stats.hits, cascades[c].stats.redraws);
 	}
+	ImGui::Text("%u cascades redrawn last frame, %.3f ms (GPU), %.1f MB", cascadesUpdated, timer.lastTime, memoryUsed / (1024.0f * 1024.0f));
 }
@@ -2,35 +2,127 @@
 #define SHADOWMAP_PASS_H
 
 #include "renderpass.h"
-#include "camera.h";
+#include "camera.h"
+#include "gputimer.h"
+#include "jobsystem.h"
+#include "renderlist.h"
 #include "scene.h"
-#include "entity.h"
+#include "shadowcache.h"
 
+// passed to glighting.frag as a define
+#define MAX_CASCADES 4
+
+// std140 layout of the Shadows uniform block
+struct ShadowBlock {
+	glm::mat4 viewToShadow[MAX_CASCADES]; // view space to shadow map texture space
+	glm::vec4 cascadeSplits;              // view space far distance of each cascade
+	glm::vec4 texelSizes;                 // world space size of a shadow map texel per cascade
+	int cascadeCount;
+	int filter;                           // ShadowMapPass::Filter
+	float evsmExponents[2];               // positive and negative warp
+	float evsmBleedReduction;
+	int pad[3];
+};
+
+// Cascaded shadow maps for the first directional light. The camera frustum is cut into cascadeCount slices
+// with the practical split scheme and each slice gets one layer of a depth texture array.
+// Every cascade is fitted to the bounding sphere of its slice, so its size does not change when the camera turns,
+// and its origin is snapped to whole texels, so shadow edges do not shimmer when the camera moves.
+// Casters are culled against each cascade's box, anything between the light and the box is drawn with depth clamping.
+// Static casters are cached per cascade in staticDepthMap, see shadowcache.h. Since cascades follow the camera the cache
+// pays off while the camera stands still.
+// With the EVSM filter every redrawn cascade is also converted to exponentially warped depth moments, blurred with a
+// separable gaussian and mip-mapped, so the lighting pass filters with a single trilinear lookup. Since the blur
+// softens the edges anyway, EVSM holds up at half the resolution PCF needs.
 class ShadowMapPass : public RenderPass
 {
 private:
-	enum LightType {
-		Point, Direction, Spot
+	struct Cascade {
+		glm::mat4 lightSpace; // world to light clip space, as rendered
+		float split = 0.0f;
+		float texelSize = 0.0f;
+		Camera::Frustum bounds; // culling volume of lightSpace
+		std::vector<unsigned int> casters;
+		bool dirty = true;
+
+		// static cache
+		glm::mat4 cachedLightSpace;
+		bool cacheValid = false;
+		bool hadDynamic = false; // the shadow map holds more than the cache
+		ShadowCacheStats stats;
 	};
+	Cascade cascades[MAX_CASCADES];
 
 	unsigned int depthMapFBO;
-	LightType lightType;
+	unsigned int momentsFBO, blurFBO;
+	unsigned int blurTexture = 0;
+	unsigned int depthSampler; // reads the depth array without comparison
+	unsigned int frameIndex = 0;
+	glm::vec3 lastLightDir = glm::vec3(0.0f);
 
-	std::shared_ptr<Shader> depthShader;
-	std::shared_ptr<Scene> scene;
+	std::unique_ptr<Shader> depthShader;
+
+	std::unique_ptr<Shader> momentsShader;
+	std::unique_ptr<DepthLayerCopier> copier;
+	std::vector<unsigned int> staticCasters, dynamicCasters;
+	std::shared_ptr<RenderList> renderList;
 	std::shared_ptr<Camera> camera;
-	glm::mat4 createLightFrustum();
+	std::shared_ptr<Scene> scene;
+	std::shared_ptr<JobSystem> jobSystem;
+
+	void allocateDepthMap(unsigned int texture);
+	void allocateMoments();
+	void prefilter(unsigned int cascade);
+	void drawCasters(const std::vector<unsigned int>& items);
+	void computeSplits();
+	void fitCascade(Cascade& cascade, float zNear, float zFar, const glm::vec3& lightDir);
+	void uploadShadowBlock();
 
 public:
+	// texture unit of the depth array, below the light buffers
+	static const unsigned int SHADOW_MAP_UNIT = 11;
+	// texture unit of the EVSM moments, after the preprocess outputs
+	static const unsigned int SHADOW_MOMENTS_UNIT = 6;
+
+	// must match the filter constants in glighting.frag
+	enum class Filter { PCF, EVSM };
+	const char* filterNames[2] = { "PCF 5x5", "EVSM" };
+
 	unsigned int depthMap;
+	unsigned int staticDepthMap;
+	unsigned int momentsMap = 0; // EVSM only
 
-	ShadowMapPass(unsigned int width, unsigned int height, LightType lightType);
+	// settings, call setCascades() to change count or resolution
+	unsigned int cascadeCount = 4;
+	unsigned int resolution = 2048;
+	float splitLambda = 0.75f;     // 0 = uniform splits, 1 = logarithmic splits
+	float shadowDistance = 100.0f; // clamped to the camera far plane
+	// cascade i is redrawn every updateIntervals[i] frames, staggered so far cascades do not update together
+	int updateIntervals[MAX_CASCADES] = { 1, 1, 2, 4 };
+	bool enabled = true;
+	// call setFilter() to change the filter
+	Filter filter = Filter::PCF;
+	int blurRadius = 2;                              // EVSM blur taps on each side
+	float evsmExponents[2] = { 40.0f, 5.0f };        // larger is sharper, 42 is the limit of 32 bit floats
+	float evsmBleedReduction = 0.2f;                 // cuts off the tail of the Chebyshev bound
+
+	// stats of the last Render()
+	unsigned int casterCounts[MAX_CASCADES] = {};
+	unsigned int cascadesUpdated = 0;
+	size_t memoryUsed = 0;
+	GpuTimer timer;
+
+	ShadowMapPass(unsigned int resolution, std::shared_ptr<RenderList> renderList, std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene, std::shared_ptr<JobSystem> jobSystem);
 	~ShadowMapPass();
 	void Render() override;
-	void ResizeBuffers(unsigned int width, unsigned int height) override;
+	// the shadow map resolution does not follow the screen
+	void ResizeBuffers(unsigned int, unsigned int) override {}
 
-private:
-	void renderEntityToDepthMap(Entity& entity);
+	void setCascades(unsigned int count, unsigned int resolution);
+	void setFilter(Filter filter);
+	void invalidate();
+	void bindTextures() const;
+	void renderUI();
 };
 
-#endif
\ No newline at end of file
+#endif
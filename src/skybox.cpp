@@ -2,27 +2,55 @@
 
 const std::string SkyboxPass::skybox_faces[6] = {"right", "left", "top", "bottom", "front", "back"};
 const std::string SkyboxPass::name = "Skybox";
-const std::vector<std::string> SkyboxPass::skybox_output_textures = {};
-unsigned int SkyboxPass::loadCubemap(std::string faces[6])
+const std::vector<PostprocessPass::OutputTexture> SkyboxPass::skybox_output_textures = {};
+SkyboxPass::Faces::Faces(const std::string& directory, const std::string& extension)
 {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	source = directory + "/*." + extension;
+	for (unsigned int i = 0; i < 6; i++)
+		paths[i] = directory + "/" + skybox_faces[i] + "." + extension;
+}
+
+SkyboxPass::Faces::~Faces()
+{
+	for (unsigned int i = 0; i < 6; i++)
+		stbi_image_free(data[i]);
+}
+
+void SkyboxPass::Faces::decode(JobSystem& jobs, JobSystem::Counter& counter)
+{
+	for (unsigned int i = 0; i < 6; i++)
+		jobs.run([this, i]() { data[i] = stbi_load(paths[i].c_str(), &width[i], &height[i], &channels[i], 0); }, &counter);
+}
+
+SkyboxPass::SkyboxPass(unsigned int width, unsigned int height) : PostprocessPass(width, height, name, skybox_output_textures)
+{
+	skyboxShader = std::make_unique<Shader>("src/shaders/skybox.vert", "src/shaders/skybox.frag");
+	skyboxShader->bindUniformBlock("Matrices", 0);
+}
+
+SkyboxPass::~SkyboxPass()
+{
+	release();
+}
+
+// replaces the cubemap, must not be called while the pass is part of the render graph
+void SkyboxPass::load(const Faces& faces)
+{
+	release();
+	glGenTextures(1, &skyboxTexture);
+	GLState::bindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
 
-	int width, height, nrChannels;
 	loadFailed = false;
 	for (unsigned int i = 0; i < 6; i++) {
-		unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data) {
+		if (faces.data[i]) {
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-				0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
+				0, GL_RGB, faces.width[i], faces.height[i], 0, GL_RGB, GL_UNSIGNED_BYTE, faces.data[i]
 			);
-			stbi_image_free(data);
+			memoryUsed += (size_t)faces.width[i] * faces.height[i] * 4; // RGB8 is padded to 4 bytes by most drivers
 		}
 		else {
-			std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
+			std::cout << "Cubemap tex failed to load at path: " << faces.paths[i] << std::endl;
 			loadFailed = true;
-			stbi_image_free(data);
 		}
 	}
 
@@ -32,30 +60,31 @@ unsigned int SkyboxPass::loadCubemap(std::string faces[6])
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-	return textureID;
+	if (loadFailed) release();
+	else source = faces.source;
 }
 
-SkyboxPass::SkyboxPass(unsigned int width, unsigned int height, const std::shared_ptr<DeferredLightingPass> lighting, std::string faces[6]) : PostprocessPass(width, height, lighting, name, skybox_output_textures)
+void SkyboxPass::release()
 {
-	skyboxTexture = loadCubemap(faces);
-
-	skyboxShader = std::make_unique<Shader>("src/shaders/skybox.vert", "src/shaders/skybox.frag");
-	skyboxShader->use();
-	skyboxShader->setInt("cubemap", 0);
-
-	skyboxShader->bindUniformBlock("Matrices", 0);
+	GLState::deleteTextures(1, &skyboxTexture);
+	skyboxTexture = 0;
+	memoryUsed = 0;
+	source.clear();
 }
 
-SkyboxPass::~SkyboxPass()
+// drawn into the lit image behind everything the G-buffer covers
+void SkyboxPass::Setup(RenderGraph::Builder& builder)
 {
-	glDeleteTextures(1, &skyboxTexture);
+	hdrColor = builder.modify("hdrColor");
+	gDepth = builder.use("gDepth");
+	builder.importTexture("skybox", skyboxTexture, GL_TEXTURE_CUBE_MAP);
+	skyboxShader->use();
+	skyboxShader->setInt("cubemap", builder.read("skybox"));
 }
 
 void SkyboxPass::Render()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, lighting->hdrFBO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
+	graph->bindFramebuffer({ hdrColor }, gDepth);
 
 	skyboxShader->use();
 	RenderCube();
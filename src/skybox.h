@@ -2,23 +2,45 @@
 #define SKYBOX_H
 
 #include "postprocesspass.h"
+#include "jobsystem.h"
 #include "stb_image.h"
 
+// The pass lives as long as the renderer, only its cubemap is loaded and released. The faces are decoded on the job
+// system into Faces first, so they can be prepared before the skybox is switched on.
 class SkyboxPass : public PostprocessPass
 {
 private:
-	unsigned int skyboxTexture;
+	unsigned int skyboxTexture = 0;
 	std::unique_ptr<Shader> skyboxShader;
 
 	static const std::string name;
-	static const std::vector<std::string> skybox_output_textures;
+	static const std::vector<OutputTexture> skybox_output_textures;
+	RenderGraph::Resource hdrColor, gDepth;
 public:
 	static const std::string skybox_faces[6];
+
+	// decoded images of the six faces
+	struct Faces {
+		std::string source; // directory and extension
+		std::string paths[6];
+		unsigned char* data[6] = {};
+		int width[6] = {}, height[6] = {}, channels[6] = {};
+
+		Faces(const std::string& directory, const std::string& extension);
+		~Faces();
+		// one job per face, the faces must stay alive until the counter is done
+		void decode(JobSystem& jobs, JobSystem::Counter& counter);
+	};
+
+	std::string source; // of the loaded cubemap, empty when none is loaded
 	bool loadFailed = false;
+	size_t memoryUsed = 0;
 
-	unsigned int loadCubemap(std::string faces[6]);
-	SkyboxPass(unsigned int width, unsigned int height, const std::shared_ptr<DeferredLightingPass> lighting, std::string faces[6]);
+	SkyboxPass(unsigned int width, unsigned int height);
 	~SkyboxPass();
+	void load(const Faces& faces);
+	void release();
+	void Setup(RenderGraph::Builder& builder) override;
 	void Render() override;
 	void ResizeBuffers(unsigned int width, unsigned int height) override;
 };
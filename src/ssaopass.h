@@ -2,22 +2,34 @@
 #define SSAOPASS_H
 
 #include "preprocesspass.h"
-#include "gbuffer.h"
+#include "uniformbuffer.h"
+
+// std140 layout of the SSAOParams uniform block
+struct SSAOBlock {
+	glm::vec4 samples[64]; // view space kernel, xyz
+	glm::vec2 noiseScale;  // screen size / noise texture size
+	float radius;
+	float bias;
+};
 
 class SSAOPass : public PreprocessPass
 {
 private:
-	unsigned int ssaoFBO, ssaoBlurFBO;
-	unsigned int noiseTexture, ssaoBlurBuffer;
+	unsigned int noiseTexture;
+	RenderGraph::Resource ssaoRaw, ssaoBlurred;
 	std::unique_ptr<Shader> ssaoShader;
 	std::unique_ptr<Shader> ssaoBlurShader;
+	UniformBuffer<SSAOBlock> params;
 
 	static const std::string name;
 	static const std::vector<std::string> ssao_output_textures;
 
 public:
-	SSAOPass(unsigned int width, unsigned int height, const std::shared_ptr<GBufferPass> gBuffer);
+	static const unsigned int PARAMS_BINDING = 3;
+
+	SSAOPass(unsigned int width, unsigned int height);
 	~SSAOPass();
+	void Setup(RenderGraph::Builder& builder) override;
 	void Render() override;
 	void ResizeBuffers(unsigned int width, unsigned int height) override;
 };
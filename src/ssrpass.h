@@ -2,12 +2,11 @@
 #define SSRPASS_H
 
 #include "preprocesspass.h"
-#include "gbuffer.h"
 
 class SSRPass : public PreprocessPass
 {
 private:
-	unsigned int ssrFBO, ssrBlurFBO;
+	RenderGraph::Resource ssrTarget;
 	std::unique_ptr<Shader> ssrShader;
 
 	static const std::string name;
@@ -15,8 +14,9 @@ private:
 
 public:
 
-	SSRPass(unsigned int width, unsigned int height, const std::shared_ptr<GBufferPass> gBuffer);
+	SSRPass(unsigned int width, unsigned int height);
 	~SSRPass();
+	void Setup(RenderGraph::Builder& builder) override;
 	void Render() override;
 	void ResizeBuffers(unsigned int width, unsigned int height) override;
 };
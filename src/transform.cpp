@@ -0,0 +1,266 @@
+#include "transform.h"
+#include "jobsystem.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_SIMD
+#include <emmintrin.h>
+#endif
+
+namespace {
+#ifdef TRANSFORM_SIMD
+	// local matrix built straight from translation, rotation and scale: the rotation columns are scaled
+	// and the translation becomes the last column, so no intermediate mat4 products are needed
+	inline void composeTRS(const glm::vec3& t, const glm::quat& q, const glm::vec3& s, __m128 out[4]) {
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+		out[0] = _mm_mul_ps(_mm_setr_ps(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f), _mm_set1_ps(s.x));
+		out[1] = _mm_mul_ps(_mm_setr_ps(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f), _mm_set1_ps(s.y));
+		out[2] = _mm_mul_ps(_mm_setr_ps(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f), _mm_set1_ps(s.z));
+		out[3] = _mm_setr_ps(t.x, t.y, t.z, 1.0f);
+	}
+
+	// out = parent * local, one column at a time as a linear combination of the parent's columns
+	inline void multiply(const float* parent, const __m128 local[4], __m128 out[4]) {
+		__m128 p0 = _mm_loadu_ps(parent + 0), p1 = _mm_loadu_ps(parent + 4);
+		__m128 p2 = _mm_loadu_ps(parent + 8), p3 = _mm_loadu_ps(parent + 12);
+		for (int c = 0; c < 4; c++) {
+			__m128 l = local[c];
+			__m128 r = _mm_mul_ps(p0, _mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)));
+			r = _mm_add_ps(r, _mm_mul_ps(p1, _mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1))));
+			r = _mm_add_ps(r, _mm_mul_ps(p2, _mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2))));
+			r = _mm_add_ps(r, _mm_mul_ps(p3, _mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3))));
+			out[c] = r;
+		}
+	}
+
+	inline __m128 cross(__m128 a, __m128 b) {
+		__m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	inline float dot3(__m128 a, __m128 b) {
+		float r[4];
+		_mm_storeu_ps(r, _mm_mul_ps(a, b));
+		return r[0] + r[1] + r[2];
+	}
+
+	// inverse transpose of the upper 3x3 is the cofactor matrix divided by the determinant
+	inline void normalMatrix(const __m128 m[4], glm::mat3& out) {
+		__m128 n0 = cross(m[1], m[2]);
+		__m128 n1 = cross(m[2], m[0]);
+		__m128 n2 = cross(m[0], m[1]);
+		float det = dot3(m[0], n0);
+		__m128 invDet = _mm_set1_ps(det != 0.0f ? 1.0f / det : 0.0f);
+
+		float r[4];
+		_mm_storeu_ps(r, _mm_mul_ps(n0, invDet)); out[0] = glm::vec3(r[0], r[1], r[2]);
+		_mm_storeu_ps(r, _mm_mul_ps(n1, invDet)); out[1] = glm::vec3(r[0], r[1], r[2]);
+		_mm_storeu_ps(r, _mm_mul_ps(n2, invDet)); out[2] = glm::vec3(r[0], r[1], r[2]);
+	}
+#else
+	inline glm::mat4 composeTRS(const glm::vec3& t, const glm::quat& q, const glm::vec3& s) {
+		glm::mat3 r = glm::mat3_cast(q);
+		return glm::mat4(glm::vec4(r[0] * s.x, 0.0f), glm::vec4(r[1] * s.y, 0.0f), glm::vec4(r[2] * s.z, 0.0f), glm::vec4(t, 1.0f));
+	}
+
+	inline glm::mat3 normalMatrix(const glm::mat4& m) {
+		glm::vec3 c0(m[0]), c1(m[1]), c2(m[2]);
+		glm::vec3 n0 = glm::cross(c1, c2), n1 = glm::cross(c2, c0), n2 = glm::cross(c0, c1);
+		float det = glm::dot(c0, n0);
+		return glm::mat3(n0, n1, n2) * (det != 0.0f ? 1.0f / det : 0.0f);
+	}
+#endif
+}
+
+const unsigned int TransformHierarchy::invalid;
+
+unsigned int TransformHierarchy::add(unsigned int parentHandle)
+{
+	unsigned int handle;
+	addBatch(parentHandle, 1, &handle);
+	return handle;
+}
+
+// Adds count leaf children under the same parent with a single shift of the arrays
+void TransformHierarchy::addBatch(unsigned int parentHandle, unsigned int count, unsigned int* handlesOut)
+{
+	// insert at the end of the parent's subtree so the depth-first order is kept;
+	// nodes added under the last subtree (the common case) are appended without shifting
+	unsigned int parent = invalid, pos = (unsigned int)size();
+	if (parentHandle != invalid) {
+		parent = handleToNode[parentHandle];
+		pos = parent + subtreeSizes[parent];
+		for (unsigned int a = parent; a != invalid; a = parents[a]) subtreeSizes[a] += count;
+	}
+
+	if (pos != size()) {
+		for (unsigned int i = pos; i < size(); i++) {
+			if (parents[i] != invalid && parents[i] >= pos) parents[i] += count;
+			handleToNode[nodeToHandle[i]] += count;
+		}
+	}
+
+	std::vector<unsigned int> handles(count);
+	for (unsigned int i = 0; i < count; i++) {
+		if (!freeHandles.empty()) {
+			handles[i] = freeHandles.back();
+			freeHandles.pop_back();
+			handleToNode[handles[i]] = pos + i;
+		}
+		else {
+			handles[i] = (unsigned int)handleToNode.size();
+			handleToNode.push_back(pos + i);
+		}
+		handlesOut[i] = handles[i];
+	}
+
+	parents.insert(parents.begin() + pos, count, parent);
+	subtreeSizes.insert(subtreeSizes.begin() + pos, count, 1);
+	positions.insert(positions.begin() + pos, count, glm::vec3(0.0f));
+	rotations.insert(rotations.begin() + pos, count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	scales.insert(scales.begin() + pos, count, glm::vec3(1.0f));
+	dirty.insert(dirty.begin() + pos, count, true);
+	changed.insert(changed.begin() + pos, count, false);
+	modelMatrices.insert(modelMatrices.begin() + pos, count, glm::mat4(1.0f));
+	normalMatrices.insert(normalMatrices.begin() + pos, count, glm::mat3(1.0f));
+	rotationsEul.insert(rotationsEul.begin() + pos, count, glm::vec3(0.0f));
+	nodeToHandle.insert(nodeToHandle.begin() + pos, handles.begin(), handles.end());
+}
+
+// Removes the given nodes together with their subtrees and compacts the arrays in one pass.
+// The handles of every removed node (descendants included) are appended to removed and recycled.
+void TransformHierarchy::remove(const std::vector<unsigned int>& handles, std::vector<unsigned int>& removed)
+{
+	std::vector<unsigned char> dead(size(), 0);
+	for (unsigned int handle : handles) {
+		unsigned int n = handleToNode[handle];
+		if (n == invalid) continue;
+		std::fill(dead.begin() + n, dead.begin() + n + subtreeSizes[n], 1);
+	}
+
+	// parents precede their children, so a surviving node's parent has already been moved when it is reached
+	std::vector<unsigned int> remap(size());
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < size(); i++) {
+		unsigned int handle = nodeToHandle[i];
+		if (dead[i]) {
+			remap[i] = invalid;
+			handleToNode[handle] = invalid;
+			freeHandles.push_back(handle);
+			removed.push_back(handle);
+			continue;
+		}
+
+		remap[i] = count;
+		parents[count] = parents[i] == invalid ? invalid : remap[parents[i]];
+		positions[count] = positions[i];
+		rotations[count] = rotations[i];
+		scales[count] = scales[i];
+		dirty[count] = dirty[i];
+		changed[count] = changed[i];
+		modelMatrices[count] = modelMatrices[i];
+		normalMatrices[count] = normalMatrices[i];
+		rotationsEul[count] = rotationsEul[i];
+		nodeToHandle[count] = handle;
+		handleToNode[handle] = count;
+		count++;
+	}
+
+	parents.resize(count);
+	subtreeSizes.resize(count);
+	positions.resize(count);
+	rotations.resize(count);
+	scales.resize(count);
+	dirty.resize(count);
+	changed.resize(count);
+	modelMatrices.resize(count);
+	normalMatrices.resize(count);
+	rotationsEul.resize(count);
+	nodeToHandle.resize(count);
+
+	// subtree sizes are rebuilt bottom-up, children follow their parents
+	std::fill(subtreeSizes.begin(), subtreeSizes.end(), 1);
+	for (unsigned int i = count; i-- > 0;)
+		if (parents[i] != invalid) subtreeSizes[parents[i]] += subtreeSizes[i];
+}
+
+void TransformHierarchy::update(JobSystem* jobs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	unsigned int count = (unsigned int)size();
+	unsigned int grain = (jobs) ? count / (jobs->threadCount() * 4) : count;
+
+	if (!jobs || jobs->threadCount() == 1 || grain < 1024) {
+		updateRange(0, count);
+	}
+	else {
+		std::vector<std::pair<unsigned int, unsigned int>> ranges;
+		partition(0, count, grain, ranges);
+		jobs->parallelFor((unsigned int)ranges.size(), 1, [this, &ranges](unsigned int begin, unsigned int end) {
+			for (unsigned int r = begin; r < end; r++) updateRange(ranges[r].first, ranges[r].second);
+		});
+	}
+	lastUpdateTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Split the sibling subtrees in [begin, end) into independent ranges of roughly grain nodes. Runs of small
+// sibling subtrees are contiguous and get merged into one range; a subtree larger than grain has its root
+// updated right away and its children partitioned in turn, so every range only depends on nodes already updated.
+void TransformHierarchy::partition(unsigned int begin, unsigned int end, unsigned int grain, std::vector<std::pair<unsigned int, unsigned int>>& ranges)
+{
+	unsigned int runStart = begin;
+	for (unsigned int i = begin; i < end; i += subtreeSizes[i]) {
+		unsigned int subtreeEnd = i + subtreeSizes[i];
+		if (subtreeSizes[i] > grain) {
+			if (runStart < i) ranges.emplace_back(runStart, i);
+			updateRange(i, i + 1);
+			partition(i + 1, subtreeEnd, grain, ranges);
+			runStart = subtreeEnd;
+		}
+		else if (subtreeEnd - runStart > grain) {
+			if (runStart < i) ranges.emplace_back(runStart, i);
+			runStart = i;
+		}
+	}
+	if (runStart < end) ranges.emplace_back(runStart, end);
+}
+
+// Recompute world matrices for nodes in [begin, end). Parents outside of the range must already be up to date,
+// so a range is either the whole array or a set of complete subtrees.
+void TransformHierarchy::updateRange(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++) {
+		unsigned int p = parents[i];
+		if (!dirty[i] && (p == invalid || !changed[p])) {
+			changed[i] = false;
+			continue;
+		}
+
+#ifdef TRANSFORM_SIMD
+		__m128 local[4], world[4];
+		composeTRS(positions[i], rotations[i], scales[i], local);
+		if (p != invalid)
+			multiply(glm::value_ptr(modelMatrices[p]), local, world);
+		else
+			for (int c = 0; c < 4; c++) world[c] = local[c];
+
+		float* m = glm::value_ptr(modelMatrices[i]);
+		for (int c = 0; c < 4; c++) _mm_storeu_ps(m + 4 * c, world[c]);
+		normalMatrix(world, normalMatrices[i]);
+#else
+		glm::mat4 local = composeTRS(positions[i], rotations[i], scales[i]);
+		modelMatrices[i] = (p != invalid) ? modelMatrices[p] * local : local;
+		normalMatrices[i] = normalMatrix(modelMatrices[i]);
+#endif
+
+		dirty[i] = false;
+		changed[i] = true;
+	}
+}
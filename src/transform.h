@@ -0,0 +1,122 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include <climits>
+
+#include <imgui/imgui.h>
+
+class JobSystem;
+
+// Flat transform storage. Nodes are kept in depth-first order so every parent precedes its children
+// and each subtree occupies a contiguous range, which lets update() propagate dirty flags in one linear sweep.
+// Nodes are referred to by stable handles, since dense indices shift when a node is inserted mid-array.
+class TransformHierarchy {
+public:
+	static const unsigned int invalid = UINT_MAX;
+
+	// hot data, indexed by dense node index
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> subtreeSizes;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<unsigned char> dirty;
+	std::vector<unsigned char> changed; // world matrix was recomputed in the last update
+	std::vector<glm::mat4> modelMatrices;
+	std::vector<glm::mat3> normalMatrices;
+
+	// cold data, only touched by the UI
+	std::vector<glm::vec3> rotationsEul;
+
+	// time taken by the last update() in milliseconds
+	float lastUpdateTime = 0.0f;
+
+	unsigned int add(unsigned int parentHandle);
+	void addBatch(unsigned int parentHandle, unsigned int count, unsigned int* handlesOut);
+	void remove(const std::vector<unsigned int>& handles, std::vector<unsigned int>& removed);
+	void update(JobSystem* jobs = nullptr);
+	void updateRange(unsigned int begin, unsigned int end);
+
+	unsigned int node(unsigned int handle) const { return handleToNode[handle]; }
+	unsigned int handle(unsigned int node) const { return nodeToHandle[node]; }
+	size_t size() const { return parents.size(); }
+
+private:
+	std::vector<unsigned int> handleToNode;
+	std::vector<unsigned int> nodeToHandle;
+	std::vector<unsigned int> freeHandles;
+
+	void partition(unsigned int begin, unsigned int end, unsigned int grain, std::vector<std::pair<unsigned int, unsigned int>>& ranges);
+};
+
+// Lightweight view of a node in a TransformHierarchy
+struct Transform {
+	TransformHierarchy* hierarchy = nullptr;
+	unsigned int handle = TransformHierarchy::invalid;
+
+	void setLocalPosition(const glm::vec3& newPosition) {
+		unsigned int n = hierarchy->node(handle);
+		hierarchy->positions[n] = newPosition;
+		hierarchy->dirty[n] = true;
+	}
+
+	void setLocalRotation(const glm::vec3& newRotation) {
+		unsigned int n = hierarchy->node(handle);
+		hierarchy->rotationsEul[n] = newRotation;
+		hierarchy->rotations[n] = glm::quat(glm::radians(newRotation));
+		hierarchy->dirty[n] = true;
+	}
+
+	void setLocalScale(const glm::vec3& newScale) {
+		unsigned int n = hierarchy->node(handle);
+		hierarchy->scales[n] = newScale;
+		hierarchy->dirty[n] = true;
+	}
+
+	const glm::vec3 getLocalPosition() const {
+		return hierarchy->positions[hierarchy->node(handle)];
+	}
+
+	const glm::vec3 getLocalScale() const {
+		return hierarchy->scales[hierarchy->node(handle)];
+	}
+
+	const glm::vec3 getLocalRotation() const {
+		return hierarchy->rotationsEul[hierarchy->node(handle)];
+	}
+
+	const glm::mat4& getModelMatrix() const {
+		return hierarchy->modelMatrices[hierarchy->node(handle)];
+	}
+
+	const glm::mat3& getNormalMatrix() const {
+		return hierarchy->normalMatrices[hierarchy->node(handle)];
+	}
+
+	bool isDirty() const {
+		return hierarchy->dirty[hierarchy->node(handle)];
+	}
+
+	void renderUI() {
+		unsigned int n = hierarchy->node(handle);
+		ImGui::Text("Transform");
+
+		if (ImGui::DragFloat3("Position", glm::value_ptr(hierarchy->positions[n]), 0.001f)) {
+			hierarchy->dirty[n] = true;
+		}
+		if (ImGui::DragFloat3("Rotation", glm::value_ptr(hierarchy->rotationsEul[n]), 0.1f)) {
+			hierarchy->rotations[n] = glm::quat(glm::radians(hierarchy->rotationsEul[n]));
+			hierarchy->dirty[n] = true;
+		}
+		if (ImGui::DragFloat3("Scale", glm::value_ptr(hierarchy->scales[n]), 0.001f)) {
+			hierarchy->dirty[n] = true;
+		}
+	}
+};
+#endif
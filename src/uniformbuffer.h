@@ -0,0 +1,53 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+// A std140 uniform block of a pass, T must follow the std140 layout of the block. The buffer stays bound to its binding
+// point, edit() marks the data dirty and update() uploads it only then, so parameters that rarely change cost nothing
+// per frame and are shared by all shaders (and variants) that use the block.
+// Binding points: 0 Matrices, 1 Lights, 2 Shadows, 3 SSAOParams, 4 BloomParams, 5 HDRParams, 6 Object
+// (0, 1, 2 and 6 change every frame and are bound to ranges of the ConstantRing instead)
+template<typename T>
+class UniformBuffer
+{
+public:
+	unsigned int uploads = 0;
+
+	UniformBuffer(unsigned int binding)
+	{
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+	}
+	~UniformBuffer()
+	{
+		glDeleteBuffers(1, &buffer);
+	}
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	const T& get() const { return data; }
+	T& edit()
+	{
+		dirty = true;
+		return data;
+	}
+
+	void update()
+	{
+		if (!dirty) return;
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+		dirty = false;
+		uploads++;
+	}
+
+private:
+	unsigned int buffer = 0;
+	T data{};
+	bool dirty = true;
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "uploadqueue.h"
+#include "glstate.h"
+#include "stb_image.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+size_t UploadQueue::budget = 8 << 20;
+size_t UploadQueue::lastFrameBytes = 0, UploadQueue::totalBytes = 0;
+unsigned int UploadQueue::completed = 0;
+GLFWwindow* UploadQueue::context = nullptr;
+std::thread UploadQueue::thread;
+std::mutex UploadQueue::mutex;
+std::condition_variable UploadQueue::wake;
+bool UploadQueue::stopping = false;
+std::deque<UploadQueue::Job> UploadQueue::jobs;
+std::vector<std::shared_ptr<UploadQueue::Upload>> UploadQueue::finished;
+std::vector<std::shared_ptr<UploadQueue::Upload>> UploadQueue::fenced;
+long long UploadQueue::credit = LLONG_MAX;
+size_t UploadQueue::frameBytes = 0;
+size_t UploadQueue::inFlight = 0;
+UploadQueue::Slot UploadQueue::slots[UploadQueue::STAGING_SLOTS];
+unsigned int UploadQueue::nextSlot = 0;
+
+void UploadQueue::init(GLFWwindow* window)
+{
+	// created with the hints of the main window, so the contexts match and can share objects, but never shown
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	context = glfwCreateWindow(1, 1, "upload", NULL, window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (!context) {
+		std::cout << "Shared upload context not available, assets are uploaded on the render thread" << std::endl;
+		return;
+	}
+	stopping = false;
+	thread = std::thread(run);
+}
+
+void UploadQueue::shutdown()
+{
+	if (!threaded()) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	wake.notify_all();
+	thread.join();
+	glfwDestroyWindow(context);
+	context = nullptr;
+}
+
+std::shared_ptr<UploadQueue::Upload> UploadQueue::texture(GLuint texture, Image image, std::function<void(const Upload&)> done)
+{
+	Job job;
+	job.texture = texture;
+	job.image = std::move(image);
+	return submit(std::move(job), std::move(done));
+}
+
+std::shared_ptr<UploadQueue::Upload> UploadQueue::buffers(std::vector<std::pair<GLuint, std::vector<char>>> buffers, std::function<void(const Upload&)> done)
+{
+	Job job;
+	job.buffers = std::move(buffers);
+	return submit(std::move(job), std::move(done));
+}
+
+std::shared_ptr<UploadQueue::Upload> UploadQueue::submit(Job job, std::function<void(const Upload&)> done)
+{
+	job.upload = std::make_shared<Upload>();
+	job.upload->done = std::move(done);
+	job.upload->geometry = !job.buffers.empty();
+	std::shared_ptr<Upload> upload = job.upload;
+	inFlight++;
+
+	if (!threaded()) {
+		process(job, false);
+		return upload;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	wake.notify_all();
+	return upload;
+}
+
+bool UploadQueue::poll()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		lastFrameBytes = frameBytes;
+		totalBytes += frameBytes;
+		frameBytes = 0;
+		// overspending on a chunk larger than what was left is paid back from this frame's budget
+		credit = budget ? std::min(credit, 0ll) + (long long)budget : LLONG_MAX;
+		fenced.insert(fenced.end(), finished.begin(), finished.end());
+		finished.clear();
+	}
+	wake.notify_all();
+
+	// fences are shared between the contexts, a zero timeout only asks whether it has signalled
+	bool geometry = false;
+	size_t kept = 0;
+	for (size_t i = 0; i < fenced.size(); i++) {
+		Upload& upload = *fenced[i];
+		if (upload.fence) {
+			if (glClientWaitSync(upload.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+				fenced[kept++] = fenced[i];
+				continue;
+			}
+			glDeleteSync(upload.fence);
+			upload.fence = nullptr;
+		}
+		upload.ready = true;
+		if (upload.done) upload.done(upload);
+		upload.done = nullptr;
+		geometry |= upload.geometry && !upload.failed;
+		completed++;
+		inFlight--;
+	}
+	fenced.resize(kept);
+	return geometry;
+}
+
+void UploadQueue::run()
+{
+	glfwMakeContextCurrent(context);
+	for (Slot& slot : slots) {
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+		glBufferData(GL_COPY_READ_BUFFER, STAGING_SIZE, NULL, GL_STREAM_DRAW);
+	}
+
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [] { return stopping || !jobs.empty(); });
+			if (stopping) break;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		process(job, true);
+	}
+
+	for (Slot& slot : slots) {
+		if (slot.fence) glDeleteSync(slot.fence);
+		glDeleteBuffers(1, &slot.buffer);
+	}
+	glfwMakeContextCurrent(nullptr);
+}
+
+// On the upload thread (streamed) the data goes through the staging slots in chunks of at most STAGING_SIZE, each
+// paid for from the frame's budget. On the render thread it is handed to the driver in one call.
+void UploadQueue::process(Job& job, bool streamed)
+{
+	Upload& upload = *job.upload;
+
+	if (job.texture) {
+		Image& image = job.image;
+		if (!decode(image)) {
+			upload.failed = true;
+			finish(job.upload);
+			return;
+		}
+		upload.width = image.width;
+		upload.height = image.height;
+		upload.bytes += image.pixels.size();
+
+		// rows of decoded images are tightly packed
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (streamed) glBindTexture(GL_TEXTURE_2D, job.texture);
+		else GLState::bindTexture(GL_TEXTURE_2D, job.texture);
+		if (!streamed) {
+			glTexImage2D(GL_TEXTURE_2D, 0, image.internalFormat, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE, image.pixels.data());
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, 0, image.internalFormat, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE, NULL);
+			size_t rowBytes = std::max<size_t>(image.pixels.size() / std::max(image.height, 1), 1);
+			int rows = (int)std::max<size_t>(STAGING_SIZE / rowBytes, 1);
+			for (int row = 0; row < image.height; row += rows) {
+				int count = std::min(rows, image.height - row);
+				const unsigned char* data = image.pixels.data() + row * rowBytes;
+				if (!spend(count * rowBytes)) return;
+				Slot* slot = stage(data, count * rowBytes);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot ? slot->buffer : 0);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, image.width, count, image.format, GL_UNSIGNED_BYTE, slot ? NULL : data);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				if (slot) slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			}
+		}
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		image.pixels.clear();
+	}
+
+	// the copy targets are not part of any vertex array, so binding them never changes one
+	for (auto& buffer : job.buffers) {
+		const std::vector<char>& data = buffer.second;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.first);
+		if (!streamed) {
+			glBufferData(GL_COPY_WRITE_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+		}
+		else {
+			glBufferData(GL_COPY_WRITE_BUFFER, data.size(), NULL, GL_STATIC_DRAW);
+			for (size_t offset = 0; offset < data.size(); offset += STAGING_SIZE) {
+				size_t size = data.size() - offset;
+				if (size > STAGING_SIZE) size = STAGING_SIZE;
+				if (!spend(size)) return;
+				Slot* slot = stage(data.data() + offset, size);
+				if (slot) {
+					glBindBuffer(GL_COPY_READ_BUFFER, slot->buffer);
+					glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, size);
+					slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				}
+				else glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data.data() + offset);
+			}
+		}
+		upload.bytes += data.size();
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	job.buffers.clear();
+
+	// flushed, so the render thread's zero timeout wait can see it signal
+	if (streamed) {
+		upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
+	finish(job.upload);
+}
+
+// files and encoded images become raw pixels, on the upload thread when there is one
+bool UploadQueue::decode(Image& image)
+{
+	if (!image.pixels.empty()) return true;
+
+	int channels;
+	unsigned char* data = !image.file.empty()
+		? stbi_load(image.file.c_str(), &image.width, &image.height, &channels, 0)
+		: stbi_load_from_memory(image.encoded.data(), (int)image.encoded.size(), &image.width, &image.height, &channels, 0);
+	if (!data) {
+		if (!image.file.empty()) std::cout << "Texture failed to load at path: " << image.file << std::endl;
+		else std::cout << "Failed to load from memory: " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+	image.format = channels == 1 ? GL_RED : channels == 2 ? GL_RG : channels == 3 ? GL_RGB : GL_RGBA;
+	image.internalFormat = image.format;
+	image.pixels.assign(data, data + (size_t)image.width * image.height * channels);
+	image.encoded.clear();
+	stbi_image_free(data);
+	return true;
+}
+
+// blocks until the frame has budget left, false when the queue is shutting down
+bool UploadQueue::spend(size_t bytes)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	wake.wait(lock, [] { return stopping || credit > 0; });
+	if (stopping) return false;
+	credit -= (long long)bytes;
+	frameBytes += bytes;
+	return true;
+}
+
+// Copies data into the next staging slot, after waiting until the GPU has read what the slot held before.
+// nullptr when the data doesn't fit or can't be mapped, the caller then uploads from client memory.
+UploadQueue::Slot* UploadQueue::stage(const void* data, size_t size)
+{
+	if (size > STAGING_SIZE) return nullptr;
+	Slot& slot = slots[nextSlot];
+	nextSlot = (nextSlot + 1) % STAGING_SLOTS;
+	if (slot.fence) {
+		while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+	void* target = glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!target) return nullptr;
+	memcpy(target, data, size);
+	glUnmapBuffer(GL_COPY_READ_BUFFER);
+	return &slot;
+}
+
+void UploadQueue::finish(std::shared_ptr<Upload> upload)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	finished.push_back(std::move(upload));
+}
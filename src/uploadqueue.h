@@ -0,0 +1,114 @@
+#ifndef UPLOAD_QUEUE_H
+#define UPLOAD_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct GLFWwindow;
+
+// Texture and buffer uploads of loaded assets, done by a thread with its own GL context shared with the main one.
+// The render thread only creates the object names and hands over the data; the upload thread decodes images,
+// copies the data through a ring of STAGING_SLOTS staging buffers (each reused once its fence says the GPU has
+// consumed it) into the destination objects and fences the finished upload. poll() checks those fences on the render
+// thread, which may use an object only after its upload is ready. The upload thread copies at most budget bytes per
+// frame, so loading a large model spreads over several frames instead of stalling one.
+// Without init() (or when the shared context can't be created) uploads are done on the render thread straight from
+// client memory and are ready on the next poll().
+class UploadQueue {
+public:
+	static const unsigned int STAGING_SLOTS = 4;
+	static const size_t STAGING_SIZE = 4 << 20;
+
+	// one submitted upload, shared by the submitter and the queue
+	struct Upload {
+		bool ready = false;  // set by poll() once the upload is done, the objects can be used from then on
+		bool failed = false; // the image could not be decoded, the texture has no storage
+		int width = 0, height = 0; // of a texture
+		size_t bytes = 0;
+
+		// called by poll() on the render thread when the upload is done
+		std::function<void(const Upload&)> done;
+		GLsync fence = nullptr; // signalled when the GPU has the data, created in the upload context
+		bool geometry = false;
+	};
+
+	// an image file, an encoded image in memory or raw pixels
+	struct Image {
+		std::string file;
+		std::vector<unsigned char> encoded;
+		std::vector<unsigned char> pixels;
+		int width = 0, height = 0;
+		GLenum format = GL_RGBA, internalFormat = GL_RGBA; // of raw pixels, decoded images pick their own
+	};
+
+	// bytes the upload thread may copy per frame, 0 for no limit
+	static size_t budget;
+
+	// stats
+	static size_t lastFrameBytes, totalBytes;
+	static unsigned int completed;
+
+	// after the main context is current, window is the main window whose context is shared
+	static void init(GLFWwindow* window);
+	// before the main window is destroyed, uploads that are still queued are dropped
+	static void shutdown();
+	static bool threaded() { return thread.joinable(); }
+
+	// texture is an unused name, it gets the image with mipmaps and repeat wrapping
+	static std::shared_ptr<Upload> texture(GLuint texture, Image image, std::function<void(const Upload&)> done = nullptr);
+	// each buffer gets its data as GL_STATIC_DRAW storage
+	static std::shared_ptr<Upload> buffers(std::vector<std::pair<GLuint, std::vector<char>>> buffers, std::function<void(const Upload&)> done = nullptr);
+	template<typename T>
+	static std::vector<char> bytes(const std::vector<T>& data) { return std::vector<char>((const char*)data.data(), (const char*)(data.data() + data.size())); }
+
+	// once per frame on the render thread: grants the frame's budget and finishes the uploads whose fence has
+	// signalled. Returns whether any buffers became ready, shadow caches don't contain that geometry yet.
+	static bool poll();
+	static size_t pending() { return inFlight; }
+
+private:
+	struct Job {
+		std::shared_ptr<Upload> upload;
+		GLuint texture = 0;
+		Image image;
+		std::vector<std::pair<GLuint, std::vector<char>>> buffers;
+	};
+	struct Slot {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+	};
+
+	static GLFWwindow* context;
+	static std::thread thread;
+	static std::mutex mutex;
+	static std::condition_variable wake;
+	static bool stopping;
+	static std::deque<Job> jobs;                          // waiting for the upload thread
+	static std::vector<std::shared_ptr<Upload>> finished; // processed, waiting for poll()
+	static std::vector<std::shared_ptr<Upload>> fenced;   // render thread only, fence not signalled yet
+	static long long credit; // bytes the upload thread may still copy this frame, goes negative on large chunks
+	static size_t frameBytes;
+	static size_t inFlight;
+	static Slot slots[STAGING_SLOTS];
+	static unsigned int nextSlot;
+
+	static std::shared_ptr<Upload> submit(Job job, std::function<void(const Upload&)> done);
+	static void run();
+	static void process(Job& job, bool streamed);
+	static bool decode(Image& image);
+	static bool spend(size_t bytes);
+	static Slot* stage(const void* data, size_t size);
+	static void finish(std::shared_ptr<Upload> upload);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Embeds every file in src/shaders into src/shadersources.cpp, see shadersources.h.
+
+Run from the repository root after editing a shader, and commit the result:
+    python3 tools/embed_shaders.py
+"""
+import os
+
+SHADER_DIR = "src/shaders"
+OUTPUT = "src/shadersources.cpp"
+# MSVC limits a single string literal, longer sources are split into adjacent literals
+CHUNK = 4000
+
+
+def literal(source):
+    chunks, current = [], ""
+    for line in source.splitlines(keepends=True):
+        if current and len(current) + len(line) > CHUNK:
+            chunks.append(current)
+            current = ""
+        current += line
+    chunks.append(current)
+    return "\n".join('R"glsl(' + chunk + ')glsl"' for chunk in chunks)
+
+
+def main():
+    entries = []
+    for name in sorted(os.listdir(SHADER_DIR)):
+        path = SHADER_DIR + "/" + name
+        with open(path, encoding="utf-8", newline="") as f:
+            source = f.read().replace("\r\n", "\n")
+        assert ')glsl"' not in source, path
+        entries.append('\t{ "%s",\n%s },' % (path, literal(source)))
+
+    out = "\n".join([
+        "// Generated by tools/embed_shaders.py from src/shaders, do not edit",
+        '#include "shadersources.h"',
+        "",
+        "namespace {",
+        "struct EmbeddedShader {",
+        "\tconst char* path;",
+        "\tconst char* source;",
+        "};",
+        "",
+        "const EmbeddedShader shaders[] = {",
+    ] + entries + [
+        "};",
+        "}",
+        "",
+        "const char* embeddedShaderSource(const std::string& path)",
+        "{",
+        "\tfor (const EmbeddedShader& shader : shaders)",
+        "\t\tif (path == shader.path) return shader.source;",
+        "\treturn nullptr;",
+        "}",
+        "",
+    ])
+    with open(OUTPUT, "w", encoding="utf-8", newline="\r\n") as f:
+        f.write(out)
+
+
+if __name__ == "__main__":
+    main()